@@ -73,8 +73,8 @@ static void AddAddress (Ptr<Node> node, Time at, const char *name, const char *a
 
 // some global variables :-)
 
-  Tpa stats; // Declare global Tpa object named stats witch is 
-             //used to load informations for analyzing performances
+  Ptr<Tpa> stats; // Declare global Tpa object named stats witch is 
+                  //used to load informations for analyzing performances
 
   double startAppTime;
   double stopAppTime;
@@ -87,30 +87,6 @@ static void AddAddress (Ptr<Node> node, Time at, const char *name, const char *a
   NetDeviceContainer wifi_bck_devices3;
 
 //****Callbacks
-void TxCallback(Ptr<const Packet> tporig)
-{ 
-  double timeNow=Simulator::Now().GetMilliSeconds();
-  if ( (timeNow/1000.0) < (stopAppTime - 0.1))
-    {
-      stats.LoadSentPacket(tporig, timeNow);
-    }
-}
-
-void RxCallback(Ptr<const Packet> rporig)
-{
-  double timeNow=Simulator::Now().GetMilliSeconds();
-  if ( (timeNow/1000.0) < (stopAppTime - 0.1))
-    {
-			stats.LoadReceivedPacket(rporig, timeNow);
-    }
-}
-
-void RxControlCallback(Ptr<const Packet> rporig)
-{
-  double timeNow=Simulator::Now().GetMilliSeconds();
-  stats.LoadControlPacket(rporig, timeNow);
-}
-
 void XPositionCallback(Ptr<const MobilityModel> mob_model)
 {
   Vector position=mob_model->GetPosition();
@@ -141,6 +117,16 @@ int main(int argc, char* argv[])
   bool     callbacks_enable = true;
   bool     output_label_enable = true;
   bool     print_throughput = false;
+  bool     streaming = false;     // Tpa keeps running sums only, memory doesn't grow with the packet count
+  double   report_interval = 0;   // [ms] Tpa periodic metrics in tempseries.txt, 0 disables
+  std::string throughput_bins = "1000"; // [ms] bin widths of the print_throughput series
+  std::string record_file = "";   // Tpa binary per-packet records, empty disables
+  uint32_t record_queue = 65536;  // records queued to the background writer thread, 0 writes inline
+  bool     record_drop = false;   // drop records when the queue is full instead of waiting
+  double   handover_window = 1000; // [ms] per-handover delay/jitter windows before and after
+  std::string codec = "G.711";    // E-model codec profile of R and MOS
+  std::string output_dir = ".";   // Tpa result files, e.g. --output_dir=/root/workspace/bake/source/ns-3-dce
+  std::string run_id = "";        // appended to the Tpa result file names, for concurrent runs
   bool     pcap_enable = true;
   bool     anim_enable = false;
 
@@ -158,6 +144,16 @@ int main(int argc, char* argv[])
   cmd.AddValue ("callbacks_enable", "callbacks_enable", callbacks_enable);
   cmd.AddValue ("output_label_enable", "output_label_enable", output_label_enable);
   cmd.AddValue ("print_throughput", "print_throughput", print_throughput);
+  cmd.AddValue ("streaming", "Tpa streaming statistics (constant memory)", streaming);
+  cmd.AddValue ("throughput_bins", "print_throughput bin widths in ms, comma separated, e.g. 10,100,1000", throughput_bins);
+  cmd.AddValue ("record_file", "Tpa binary per-packet record file (seq, time, size, flow, path)", record_file);
+  cmd.AddValue ("record_queue", "record_file: queue to the writer thread (records), 0 writes from the simulator thread", record_queue);
+  cmd.AddValue ("record_drop", "record_file: drop and count records when the queue is full", record_drop);
+  cmd.AddValue ("codec", "Tpa E-model codec profile: G.711, G.729 or G.722", codec);
+  cmd.AddValue ("handover_window", "Tpa per-handover delay/jitter window before and after the handover in ms", handover_window);
+  cmd.AddValue ("report_interval", "Tpa periodic metrics interval in ms, appended to tempseries.txt (0 disables)", report_interval);
+  cmd.AddValue ("output_dir", "Tpa result files directory (tempresults.txt, results.json, ...), the working directory by default", output_dir);
+  cmd.AddValue ("run_id", "Tpa result files named tempresults-<run_id>.txt, ...; set a different one for every concurrent run", run_id);
   cmd.AddValue ("pcap_enable", "pcap_enable", pcap_enable);
   cmd.AddValue ("anim_enable", "anim_enable", anim_enable);
   cmd.Parse (argc,argv);
@@ -172,11 +168,21 @@ int main(int argc, char* argv[])
       case 4: trafficType = "VOIP"; break;
       case 5: trafficType = "VIDEO_S"; break;      
     }
-  stats.SetTrafficType (trafficType);
-  if (!output_label_enable){ stats.m_enable_column_labels = false;}
-
-// Some checks dce 1.2 doesn't support TCP UDP applications yet
-  if (traffic_type != 1 and ro_enable == true) { std::cout << "RO not implemented in Tpa; disable RO for this traffic_type!" << std::endl; return 0;}
+  TpaHelper tpaHelper;
+  tpaHelper.SetTrafficType (trafficType);
+  stats = tpaHelper.Create ();
+  if (!output_label_enable){ stats->m_enable_column_labels = false;}
+  stats->SetStreamingMode (streaming);
+  stats->SetThroughputBins (throughput_bins);
+  stats->SetRecordQueue (record_queue);
+  stats->SetRecordDropWhenFull (record_drop);
+  stats->SetRecordFile (record_file);
+  stats->SetHandoverWindow (Seconds (handover_window / 1000.0));
+  stats->SetCodec (codec);
+  stats->SetOutputDirectory (output_dir);
+  stats->SetRunId (run_id);
+
+// Tpa walks the IPv6 extension headers (RH2, HAO, tunnel), RO works for every traffic_type
 
 
 // ****Create Nodes
@@ -599,7 +605,7 @@ int main(int argc, char* argv[])
                             // 50 packets/s x 172bytes (160 payload + 12 RTP) = 50 x 172x8 = 68800 bps
                             // Mib=1024Ki=1024*1024b=1048576b   DataRateValue("10Mib/s")
       uint32_t payloadSize = 172;  // [bytes]
-      //stats.SetPacketSize(payloadSize);
+      //stats->SetPacketSize(payloadSize);
 
       uint16_t port=1234;
       OnOffHelper onoffhelper("ns3::UdpSocketFactory", Address (Inet6SocketAddress("2001:5::200:ff:fe00:202", port)));
@@ -618,9 +624,11 @@ int main(int argc, char* argv[])
     { 
       uint32_t MaxPacketSize = 1412;  // Back off 20 (IP) (+++ 60 IP) + 8 (UDP) bytes from MTU  
       uint16_t port=49153;
-      UdpTraceClientHelper client (Ipv6Address("2001:5::200:ff:fe00:202"), port,
-                                   "/root/workspace/bake/source/formula1_medium_quality.dat");
+      std::string videoTrace = "/root/workspace/bake/source/formula1_medium_quality.dat";
+      UdpTraceClientHelper client (Ipv6Address("2001:5::200:ff:fe00:202"), port, videoTrace);
       client.SetAttribute ("MaxPacketSize", UintegerValue (MaxPacketSize));
+      stats->SetVideoPacketSize (MaxPacketSize);  // frame loss, decodable frames and PSNR (tempvideo.txt)
+      stats->SetVideoTrace (videoTrace);
       ApplicationContainer apps = client.Install (cn);
       apps.Start (Seconds (startAppTime));
       apps.Stop (Seconds (stopAppTime));
@@ -759,22 +767,32 @@ int main(int argc, char* argv[])
 // Callbacks
 if (callbacks_enable)
 {
-  // sent packets
-  Config::ConnectWithoutContext("/NodeList/0/DeviceList/0/$ns3::CsmaNetDevice/MacTx", MakeCallback(&TxCallback));
-  // received packets  
-  if (trafficType == "PING")
-    {Config::ConnectWithoutContext("/NodeList/0/DeviceList/0/$ns3::CsmaNetDevice/MacRx", MakeCallback(&RxCallback));}
-  if (trafficType != "PING")
-    {Config::ConnectWithoutContext("NodeList/7/DeviceList/0/$ns3::WifiNetDevice/Mac/MacRx", MakeCallback(&RxCallback));}
-  // calculating Hendover delay
-  Config::ConnectWithoutContext("NodeList/7/DeviceList/0/$ns3::WifiNetDevice/Phy/PhyRxEnd", MakeCallback(&RxControlCallback)); 
+  // the packets sent by the CN and received by the MN (by the CN for the echo replies),
+  // until the applications stop
+  stats->SetLoadUntil (Seconds (stopAppTime - 0.1));
+  tpaHelper.Install (stats, l1_devices.Get (0), trafficType == "PING" ? l1_devices.Get (0) : wifi_sta_devices.Get (0));
+  // background flows bNodes2 -> bNodes3, each one gets its own line in tempflows.txt
+  if (background_nodes == true && trafficType != "PING")
+    {
+      for (int i = 0; i < bN; i++)
+        {
+          tpaHelper.Install (stats, wifi_bck_devices2.Get (i), wifi_bck_devices3.Get (i));
+        }
+    }
+  // calculating Hendover delay: frames received and sent by the MN (association, RS/RA, DAD, BU/BA)
+  tpaHelper.InstallHandoverDetection (stats, wifi_sta_devices.Get (0));
   // x position callback
   // Config::ConnectWithoutContext("NodeList/7/$ns3::MobilityModel/CourseChange", MakeCallback(&XPositionCallback)); 
 
   // printing performances
-  Simulator::Schedule(Seconds(endSimulationTime - 0.5), &Tpa::PrintTrafficPerformances, &stats);
+  Simulator::Schedule(Seconds(endSimulationTime - 0.5), &Tpa::PrintTrafficPerformances, stats);
   if (print_throughput){
-  Simulator::Schedule(Seconds(endSimulationTime - 0.4), &Tpa::PrintThroughput, &stats);}
+  Simulator::Schedule(Seconds(endSimulationTime - 0.4), &Tpa::PrintThroughput, stats);}
+  // periodic metrics while the simulation runs
+  if (report_interval > 0)
+    {
+      stats->SetReportInterval (Seconds (report_interval / 1000.0));
+    }
 
 }
 // pcap files
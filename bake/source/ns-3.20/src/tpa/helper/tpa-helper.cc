@@ -1,11 +1,208 @@
 /* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Goran Shekerov <g_sekerov@yahoo.com>
+ */
 
 #include "tpa-helper.h"
+#include "ns3/tpa-traffic-parser.h"
+#include "ns3/wifi-net-device.h"
+#include "ns3/wifi-mac.h"
+#include "ns3/wifi-phy.h"
+#include "ns3/mac48-address.h"
+#include "ns3/fatal-error.h"
+#include <cstring>
 
 namespace ns3 {
 
-/* ... */
+bool
+TpaDemux::Key::operator< (const Key &other) const
+{
+  return std::memcmp (address, other.address, 16) < 0;
+}
+
+TpaDemux::TpaDemux ()
+  : m_unmatched (0)
+{
+}
+
+void
+TpaDemux::Add (Ipv6Address address, Callback<void, Ptr<const Packet> > sink)
+{
+  Key key;
+  address.GetBytes (key.address);
+  m_sinks[key] = sink;
+}
+
+void
+TpaDemux::Receive (Ptr<const Packet> packet)
+{
+  TpaPacketView view (packet);
+  uint32_t ipv6Offset;
+  TpaIpv6Path ipv6Path;
+  if (!TpaIpv6Walker::FindIpv6Header (view, ipv6Offset) || !TpaIpv6Walker::Walk (view, ipv6Offset, ipv6Path))
+    {
+      return;                   // not IPv6, no node to give it to
+    }
+  TpaFlowKey flow;
+  TpaTrafficParser::ReadFlowKey (view, ipv6Path, flow);
+  Key key;
+  std::memcpy (key.address, flow.destination, 16);
+  SinkMap::const_iterator i = m_sinks.find (key);
+  if (i == m_sinks.end ())
+    {
+      std::memcpy (key.address, flow.source, 16);
+      i = m_sinks.find (key);
+    }
+  if (i == m_sinks.end ())
+    {
+      m_unmatched = m_unmatched + 1;
+      return;
+    }
+  i->second (packet);
+}
+
+uint32_t
+TpaDemux::GetNSinks (void) const
+{
+  return m_sinks.size ();
+}
+
+uint32_t
+TpaDemux::GetUnmatched (void) const
+{
+  return m_unmatched;
+}
+
+TpaHelper::TpaHelper ()
+  : m_trafficType ("UDPCBR")
+{
+  m_factory.SetTypeId ("ns3::Tpa");
+}
+
+void
+TpaHelper::SetTrafficType (std::string trafficType)
+{
+  m_trafficType = trafficType;
+}
+
+void
+TpaHelper::SetAttribute (std::string name, const AttributeValue &value)
+{
+  m_factory.Set (name, value);
+}
+
+Ptr<Tpa>
+TpaHelper::Create (void) const
+{
+  Ptr<Tpa> tpa = m_factory.Create<Tpa> ();
+  tpa->SetTrafficType (m_trafficType);
+  return tpa;
+}
+
+void
+TpaHelper::Install (Ptr<Tpa> tpa, Ptr<NetDevice> sender, Ptr<NetDevice> receiver, Ipv6Address address)
+{
+  Connect (sender, "MacTx", address, tpa->GetSentCallback ());
+  Connect (receiver, "MacRx", address, tpa->GetReceivedCallback ());
+}
 
+Ptr<Tpa>
+TpaHelper::Install (Ptr<NetDevice> sender, Ptr<NetDevice> receiver, Ipv6Address address)
+{
+  Ptr<Tpa> tpa = Create ();
+  Install (tpa, sender, receiver, address);
+  return tpa;
+}
+
+std::vector<Ptr<Tpa> >
+TpaHelper::Install (NetDeviceContainer senders, NetDeviceContainer receivers, const std::vector<Ipv6Address> &addresses)
+{
+  if (senders.GetN () != receivers.GetN () && senders.GetN () != 1)
+    {
+      NS_FATAL_ERROR ("TpaHelper: " << senders.GetN () << " senders for " << receivers.GetN () << " receivers");
+    }
+  if (!addresses.empty () && addresses.size () != receivers.GetN ())
+    {
+      NS_FATAL_ERROR ("TpaHelper: " << addresses.size () << " addresses for " << receivers.GetN () << " receivers");
+    }
+  if (senders.GetN () == 1 && receivers.GetN () > 1 && addresses.empty ())
+    {
+      NS_FATAL_ERROR ("TpaHelper: the addresses of the receivers are needed to share a sender");
+    }
+  std::vector<Ptr<Tpa> > analyzers;
+  for (uint32_t i = 0; i < receivers.GetN (); i++)
+    {
+      Ptr<NetDevice> sender = senders.Get (senders.GetN () == 1 ? 0 : i);
+      Ptr<Tpa> tpa = Install (sender, receivers.Get (i), addresses.empty () ? Ipv6Address::GetAny () : addresses[i]);
+      if (DynamicCast<WifiNetDevice> (receivers.Get (i)) != 0)
+        {
+          InstallHandoverDetection (tpa, receivers.Get (i));
+        }
+      analyzers.push_back (tpa);
+    }
+  return analyzers;
+}
+
+void
+TpaHelper::InstallHandoverDetection (Ptr<Tpa> tpa, Ptr<NetDevice> device)
+{
+  Ptr<WifiNetDevice> wifi = DynamicCast<WifiNetDevice> (device);
+  if (wifi == 0)
+    {
+      NS_FATAL_ERROR ("TpaHelper: handovers are only detected on a WifiNetDevice");
+    }
+  tpa->SetMobileNodeAddress (Mac48Address::ConvertFrom (wifi->GetAddress ()));
+  wifi->GetPhy ()->TraceConnectWithoutContext ("PhyRxEnd", tpa->GetControlCallback ());
+  wifi->GetPhy ()->TraceConnectWithoutContext ("PhyTxBegin", tpa->GetSentControlCallback ());
+}
+
+void
+TpaHelper::Connect (Ptr<NetDevice> device, std::string source, Ipv6Address address,
+                    Callback<void, Ptr<const Packet> > sink)
+{
+  if (address == Ipv6Address::GetAny ())
+    {
+      if (!ConnectDevice (device, source, sink))
+        {
+          NS_FATAL_ERROR ("TpaHelper: no " << source << " trace source on the device " << device->GetInstanceTypeId ().GetName ());
+        }
+      return;
+    }
+  Ptr<TpaDemux> &demux = m_demux[std::make_pair (PeekPointer (device), source)];
+  if (demux == 0)
+    {
+      demux = ns3::Create<TpaDemux> ();
+      if (!ConnectDevice (device, source, MakeCallback (&TpaDemux::Receive, demux)))
+        {
+          NS_FATAL_ERROR ("TpaHelper: no " << source << " trace source on the device " << device->GetInstanceTypeId ().GetName ());
+        }
+    }
+  demux->Add (address, sink);
+}
 
+bool
+TpaHelper::ConnectDevice (Ptr<NetDevice> device, std::string source, Callback<void, Ptr<const Packet> > sink)
+{
+  // the MAC trace sources of a wifi device are on its WifiMac
+  Ptr<WifiNetDevice> wifi = DynamicCast<WifiNetDevice> (device);
+  if (wifi != 0)
+    {
+      return wifi->GetMac ()->TraceConnectWithoutContext (source, sink);
+    }
+  return device->TraceConnectWithoutContext (source, sink);
 }
 
+} // namespace ns3
@@ -1,14 +1,140 @@
 /* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Goran Shekerov <g_sekerov@yahoo.com>
+ */
+
 #ifndef TPA_HELPER_H
 #define TPA_HELPER_H
 
 #include "ns3/tpa.h"
+#include "ns3/object-factory.h"
+#include "ns3/net-device-container.h"
+#include "ns3/ipv6-address.h"
+#include "ns3/simple-ref-count.h"
+#include <map>
+#include <vector>
+#include <string>
 
 namespace ns3 {
 
-/* ... */
+/**
+ * \brief Hands the packets seen by one device to the Tpa of their node
+ *
+ * A device shared by the traffic of several nodes (the CN sending to
+ * many MNs) is connected once to a demultiplexer; every packet goes to
+ * the sink of the address found as its flow destination, or else as its
+ * flow source (home addresses for route optimized packets, as in
+ * TpaFlowTable).  The packets of no registered address are dropped.
+ */
+class TpaDemux : public SimpleRefCount<TpaDemux>
+{
+public:
+  TpaDemux ();
 
-}
+  void Add (Ipv6Address address, Callback<void, Ptr<const Packet> > sink);
+  /// the trace sink of the device
+  void Receive (Ptr<const Packet> packet);
+  uint32_t GetNSinks (void) const;
+  /// \return the IPv6 packets dropped, no sink for their addresses
+  uint32_t GetUnmatched (void) const;
 
-#endif /* TPA_HELPER_H */
+private:
+  struct Key
+  {
+    uint8_t address[16];
+    bool operator< (const Key &other) const;
+  };
+  typedef std::map<Key, Callback<void, Ptr<const Packet> > > SinkMap;
+
+  SinkMap  m_sinks;
+  uint32_t m_unmatched;
+};
+
+/**
+ * \brief Creates Tpa analyzers and connects them to the trace sources of the devices
+ *
+ * The sent packets are taken from the MacTx trace source of the sender
+ * device and the received ones from the MacRx trace source of the receiver
+ * device, on the device itself (CsmaNetDevice, PointToPointNetDevice, ...)
+ * or on its WifiMac for a WifiNetDevice.  The handovers are detected from
+ * the PhyTxBegin and PhyRxEnd trace sources of the WifiPhy of the MN.  All
+ * the sinks are the context free callbacks of the Tpa, bound to the parser
+ * of its traffic type, so no callback has to be written per node.
+ *
+ * \code
+ *   TpaHelper tpaHelper;
+ *   tpaHelper.SetTrafficType ("VOIP");
+ *   tpaHelper.SetAttribute ("StreamingMode", BooleanValue (true));
+ *   std::vector<Ptr<Tpa> > analyzers = tpaHelper.Install (cnDevices, mnDevices, mnHomeAddresses);
+ * \endcode
+ */
+class TpaHelper
+{
+public:
+  TpaHelper ();
+
+  /// \param trafficType PING, UDPCBR, VOIP or VIDEO_S (Tpa::SetTrafficType)
+  void SetTrafficType (std::string trafficType);
+  /// Set an attribute of the Tpa objects created from now on
+  void SetAttribute (std::string name, const AttributeValue &value);
 
+  /// \return a new Tpa with the attributes and the traffic type of the helper, not connected
+  Ptr<Tpa> Create (void) const;
+  /**
+   * Connect a Tpa to the traffic of one node
+   * \param tpa analyzer, e.g. from Create
+   * \param sender device whose transmitted packets are the sent ones
+   * \param receiver device whose received packets are the received ones
+   * \param address address of the analyzed node (home address of an MN), for
+   *        devices that carry the traffic of several nodes; Ipv6Address::GetAny ()
+   *        connects the Tpa to every packet of the devices
+   */
+  void Install (Ptr<Tpa> tpa, Ptr<NetDevice> sender, Ptr<NetDevice> receiver,
+                Ipv6Address address = Ipv6Address::GetAny ());
+  /// \return a new Tpa connected as by the Install above
+  Ptr<Tpa> Install (Ptr<NetDevice> sender, Ptr<NetDevice> receiver,
+                    Ipv6Address address = Ipv6Address::GetAny ());
+  /**
+   * One Tpa per MN, the handovers of the MNs detected.
+   * \param senders device i sends the traffic of receiver i, or a single device sends
+   *        the traffic of all the receivers (then the addresses are needed)
+   * \param receivers the wifi devices of the MNs
+   * \param addresses home address of every MN, or empty
+   * \return the analyzers, in the order of the receivers
+   */
+  std::vector<Ptr<Tpa> > Install (NetDeviceContainer senders, NetDeviceContainer receivers,
+                                  const std::vector<Ipv6Address> &addresses = std::vector<Ipv6Address> ());
+  /**
+   * Detect the handovers of an MN from the frames of its wifi device, its MAC
+   * address given to the Tpa
+   */
+  void InstallHandoverDetection (Ptr<Tpa> tpa, Ptr<NetDevice> device);
+
+private:
+  void Connect (Ptr<NetDevice> device, std::string source, Ipv6Address address,
+                Callback<void, Ptr<const Packet> > sink);
+  static bool ConnectDevice (Ptr<NetDevice> device, std::string source,
+                             Callback<void, Ptr<const Packet> > sink);
+
+  ObjectFactory m_factory;
+  std::string   m_trafficType;
+  // one demultiplexer per shared device and trace source
+  std::map<std::pair<NetDevice *, std::string>, Ptr<TpaDemux> > m_demux;
+};
+
+} // namespace ns3
+
+#endif /* TPA_HELPER_H */
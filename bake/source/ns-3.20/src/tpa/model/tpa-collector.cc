@@ -0,0 +1,365 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Goran Shekerov <g_sekerov@yahoo.com>
+ */
+
+#include "tpa-collector.h"
+#include "tpa.h"
+#include "ns3/assert.h"
+#include <algorithm>
+#include <math.h>
+
+namespace ns3 {
+
+TpaNodeSummary::TpaNodeSummary ()
+  : sent (0),
+    received (0),
+    bytes (0),
+    duration (0.0),
+    throughput (0.0),
+    loss (0.0),
+    delay (0.0),
+    jitter (0.0),
+    delayP99 (0.0),
+    rValue (0.0),
+    mos (0.0),
+    delays (0),
+    jitters (0),
+    handovers (0),
+    l3Delay (0.0)
+{
+}
+
+double
+TpaNodeSummary::Get (Metric metric) const
+{
+  switch (metric)
+    {
+    case THROUGHPUT: return throughput;
+    case LOSS:       return loss;
+    case DELAY:      return delay;
+    case JITTER:     return jitter;
+    case DELAY_P99:  return delayP99;
+    case R_VALUE:    return rValue;
+    case MOS:        return mos;
+    case L3_DELAY:   return l3Delay;
+    }
+  return 0.0;
+}
+
+bool
+TpaNodeSummary::IsHigherBetter (Metric metric)
+{
+  return metric == THROUGHPUT || metric == R_VALUE || metric == MOS;
+}
+
+void
+TpaNodeSummary::Print (std::ostream &os, const std::string &separator) const
+{
+  os << separator << throughput;
+  os << separator << loss;
+  os << separator << delay;
+  os << separator << jitter;
+  os << separator << delayP99;
+  os << separator << rValue;
+  os << separator << mos;
+  os << separator << sent;
+  os << separator << received;
+  os << separator << handovers;
+  os << separator << l3Delay;
+}
+
+TpaCollector::TpaCollector ()
+{
+}
+
+void
+TpaCollector::Add (Ptr<Tpa> tpa)
+{
+  TpaNodeSummary summary = tpa->GetSummary ();
+  std::vector<TpaHandoverImpact> handovers;
+  for (uint32_t i = 0; i < tpa->GetNHandovers (); i++)
+    {
+      handovers.push_back (tpa->GetHandoverImpact (i));
+    }
+  Add (summary, tpa->GetDelayHistogram (), tpa->GetJitterHistogram (), tpa->GetLossRuns (), handovers);
+}
+
+void
+TpaCollector::Add (const TpaNodeSummary &summary, const TpaHistogram &delay, const TpaHistogram &jitter,
+                   const TpaLossRuns &lossRuns, const std::vector<TpaHandoverImpact> &handovers)
+{
+  m_delayHistogram.Merge (delay);
+  m_jitterHistogram.Merge (jitter);
+  m_lossRuns.Merge (lossRuns);
+  m_handovers.insert (m_handovers.end (), handovers.begin (), handovers.end ());
+  m_handoverNodes.insert (m_handoverNodes.end (), handovers.size (), m_nodes.size ());
+  m_nodes.push_back (summary);
+}
+
+void
+TpaCollector::Clear (void)
+{
+  m_nodes.clear ();
+  m_delayHistogram.Reset ();
+  m_jitterHistogram.Reset ();
+  m_lossRuns = TpaLossRuns ();
+  m_handovers.clear ();
+  m_handoverNodes.clear ();
+}
+
+uint32_t
+TpaCollector::GetNNodes (void) const
+{
+  return m_nodes.size ();
+}
+
+const TpaNodeSummary &
+TpaCollector::GetNode (uint32_t i) const
+{
+  return m_nodes[i];
+}
+
+uint64_t
+TpaCollector::GetSent (void) const
+{
+  uint64_t sent = 0;
+  for (uint32_t i = 0; i < m_nodes.size (); i++)
+    {
+      sent = sent + m_nodes[i].sent;
+    }
+  return sent;
+}
+
+uint64_t
+TpaCollector::GetReceived (void) const
+{
+  uint64_t received = 0;
+  for (uint32_t i = 0; i < m_nodes.size (); i++)
+    {
+      received = received + m_nodes[i].received;
+    }
+  return received;
+}
+
+double
+TpaCollector::GetLoss (void) const
+{
+  uint64_t sent = GetSent ();
+  uint64_t received = GetReceived ();
+  return sent > received ? (sent - received) * 100.0 / sent : 0.0;
+}
+
+double
+TpaCollector::GetThroughput (void) const
+{
+  double throughput = 0.0;
+  for (uint32_t i = 0; i < m_nodes.size (); i++)
+    {
+      throughput = throughput + m_nodes[i].throughput;
+    }
+  return throughput;
+}
+
+double
+TpaCollector::GetDelay (void) const
+{
+  // the means of the nodes weighted by their number of delays
+  double sum = 0.0;
+  uint64_t count = 0;
+  for (uint32_t i = 0; i < m_nodes.size (); i++)
+    {
+      sum = sum + m_nodes[i].delay * m_nodes[i].delays;
+      count = count + m_nodes[i].delays;
+    }
+  return count > 0 ? sum / count : 0.0;
+}
+
+double
+TpaCollector::GetJitter (void) const
+{
+  double sum = 0.0;
+  uint64_t count = 0;
+  for (uint32_t i = 0; i < m_nodes.size (); i++)
+    {
+      sum = sum + m_nodes[i].jitter * m_nodes[i].jitters;
+      count = count + m_nodes[i].jitters;
+    }
+  return count > 0 ? sum / count : 0.0;
+}
+
+const TpaHistogram &
+TpaCollector::GetDelayHistogram (void) const
+{
+  return m_delayHistogram;
+}
+
+const TpaHistogram &
+TpaCollector::GetJitterHistogram (void) const
+{
+  return m_jitterHistogram;
+}
+
+const TpaLossRuns &
+TpaCollector::GetLossRuns (void) const
+{
+  return m_lossRuns;
+}
+
+const std::vector<TpaHandoverImpact> &
+TpaCollector::GetHandovers (void) const
+{
+  return m_handovers;
+}
+
+uint32_t
+TpaCollector::GetHandoverNode (uint32_t i) const
+{
+  return m_handoverNodes[i];
+}
+
+std::vector<double>
+TpaCollector::GetValues (TpaNodeSummary::Metric metric) const
+{
+  std::vector<double> values (m_nodes.size ());
+  for (uint32_t i = 0; i < m_nodes.size (); i++)
+    {
+      values[i] = m_nodes[i].Get (metric);
+    }
+  return values;
+}
+
+double
+TpaCollector::GetFairnessIndex (TpaNodeSummary::Metric metric) const
+{
+  return GetFairnessIndex (GetValues (metric));
+}
+
+double
+TpaCollector::GetFairnessIndex (const std::vector<double> &values)
+{
+  double sum = 0.0;
+  double squares = 0.0;
+  for (uint32_t i = 0; i < values.size (); i++)
+    {
+      sum = sum + values[i];
+      squares = squares + values[i] * values[i];
+    }
+  if (squares <= 0.0)
+    {
+      return 1.0;
+    }
+  return sum * sum / (values.size () * squares);
+}
+
+uint32_t
+TpaCollector::GetWorstNode (TpaNodeSummary::Metric metric) const
+{
+  NS_ASSERT_MSG (!m_nodes.empty (), "TpaCollector without nodes");
+  bool higherBetter = TpaNodeSummary::IsHigherBetter (metric);
+  uint32_t worst = 0;
+  for (uint32_t i = 1; i < m_nodes.size (); i++)
+    {
+      double value = m_nodes[i].Get (metric);
+      double worstValue = m_nodes[worst].Get (metric);
+      if (higherBetter ? value < worstValue : value > worstValue)
+        {
+          worst = i;
+        }
+    }
+  return worst;
+}
+
+double
+TpaCollector::GetQuantile (TpaNodeSummary::Metric metric, double q) const
+{
+  if (m_nodes.empty ())
+    {
+      return 0.0;
+    }
+  std::vector<double> values = GetValues (metric);
+  uint32_t rank = uint32_t (ceil (q * values.size ()));
+  uint32_t index = rank > 0 ? rank - 1 : 0;
+  index = index < values.size () ? index : values.size () - 1;
+  std::nth_element (values.begin (), values.begin () + index, values.end ());
+  return values[index];
+}
+
+void
+TpaCollector::Print (std::ostream &os, const std::string &separator) const
+{
+  double mos = 0.0;
+  for (uint32_t i = 0; i < m_nodes.size (); i++)
+    {
+      mos = mos + m_nodes[i].mos;
+    }
+  double l3 = 0.0;
+  uint32_t l3Count = 0;
+  double outage = 0.0;
+  uint32_t outageCount = 0;
+  uint32_t lost = 0;
+  for (uint32_t i = 0; i < m_handovers.size (); i++)
+    {
+      if (m_handovers[i].l3Delay >= 0.0)
+        {
+          l3 = l3 + m_handovers[i].l3Delay;
+          l3Count++;
+        }
+      if (m_handovers[i].GetOutage () >= 0.0)
+        {
+          outage = outage + m_handovers[i].GetOutage ();
+          outageCount++;
+        }
+      lost = lost + m_handovers[i].GetLost ();
+    }
+  bool empty = m_nodes.empty ();
+  os << m_nodes.size ();
+  os << separator << GetSent ();
+  os << separator << GetReceived ();
+  os << separator << GetThroughput ();
+  os << separator << GetFairnessIndex (TpaNodeSummary::THROUGHPUT);
+  os << separator << GetQuantile (TpaNodeSummary::THROUGHPUT, 0.0);
+  os << separator << GetQuantile (TpaNodeSummary::THROUGHPUT, 0.5);
+  os << separator << GetQuantile (TpaNodeSummary::THROUGHPUT, 1.0);
+  os << separator << GetLoss ();
+  os << separator << GetDelay ();
+  os << separator << m_delayHistogram.GetQuantile (0.5);
+  os << separator << m_delayHistogram.GetQuantile (0.99);
+  os << separator << GetJitter ();
+  os << separator << m_jitterHistogram.GetQuantile (0.99);
+  os << separator << (empty ? 0.0 : mos / m_nodes.size ());
+  os << separator << GetQuantile (TpaNodeSummary::MOS, 0.0);
+  os << separator << m_handovers.size ();
+  os << separator << (l3Count > 0 ? l3 / l3Count : 0.0);
+  os << separator << (outageCount > 0 ? outage / outageCount : 0.0);
+  os << separator << lost;
+  os << separator << (empty ? 0 : GetWorstNode (TpaNodeSummary::THROUGHPUT));
+  os << separator << (empty ? 0 : GetWorstNode (TpaNodeSummary::LOSS));
+  os << separator << (empty ? 0 : GetWorstNode (TpaNodeSummary::DELAY_P99));
+}
+
+void
+TpaCollector::PrintNodes (std::ostream &os, const std::string &separator) const
+{
+  for (uint32_t i = 0; i < m_nodes.size (); i++)
+    {
+      os << i;
+      m_nodes[i].Print (os, separator);
+      os << std::endl;
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,157 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Goran Shekerov <g_sekerov@yahoo.com>
+ */
+
+#ifndef TPA_COLLECTOR_H
+#define TPA_COLLECTOR_H
+
+#include "ns3/ptr.h"
+#include "tpa-histogram.h"
+#include "tpa-loss-runs.h"
+#include "tpa-handover-timeline.h"
+#include <stdint.h>
+#include <vector>
+#include <iostream>
+
+namespace ns3 {
+
+class Tpa;
+
+/**
+ * \brief Results of the Tpa of one node, the fields of its result line
+ */
+struct TpaNodeSummary
+{
+  enum Metric
+  {
+    THROUGHPUT = 0,  //!< [Kbps]
+    LOSS,            //!< [%]
+    DELAY,           //!< mean [ms]
+    JITTER,          //!< mean [ms]
+    DELAY_P99,       //!< [ms]
+    R_VALUE,
+    MOS,
+    L3_DELAY         //!< [ms]
+  };
+
+  uint32_t sent;
+  uint32_t received;
+  uint64_t bytes;       //!< received
+  double   duration;    //!< first to last received packet [ms]
+  double   throughput;  //!< [Kbps]
+  double   loss;        //!< [%]
+  double   delay;       //!< mean [ms]
+  double   jitter;      //!< mean [ms]
+  double   delayP99;    //!< [ms]
+  double   rValue;
+  double   mos;
+  uint32_t delays;      //!< delay samples
+  uint32_t jitters;     //!< jitter samples
+  uint32_t handovers;
+  double   l3Delay;     //!< L3 delay of the last complete handover [ms], 0 if none
+
+  TpaNodeSummary ();
+  double Get (Metric metric) const;
+  /// \return true if a bigger value of the metric is better (throughput, R, MOS)
+  static bool IsHigherBetter (Metric metric);
+  /**
+   * Write Th[Kbps] Pl[%] D[ms] J[ms] D99[ms] R MOS Ns Nr Nh L3[ms],
+   * every field preceded by separator
+   */
+  void Print (std::ostream &os, const std::string &separator) const;
+};
+
+/**
+ * \brief Merges the results of the Tpa of many nodes
+ *
+ * With one Tpa per MN, the collector is given every Tpa once its traffic
+ * is over (Add).  It keeps a TpaNodeSummary of about 100 bytes per node,
+ * for the distributions across the nodes (Jain's fairness index, worst
+ * node, quantiles), and merges everything else into one copy: the delay
+ * and jitter histograms, the loss runs (all the flows of all the nodes)
+ * and the impact of every handover.  The Tpa can be disposed after Add,
+ * which releases its packet records, so the memory left per node does not
+ * grow with the number of packets.
+ */
+class TpaCollector
+{
+public:
+  TpaCollector ();
+
+  /// \param tpa analyzer of one node; its results are calculated now if they aren't yet
+  void Add (Ptr<Tpa> tpa);
+  /**
+   * Add the results of a node without its Tpa (e.g. read back from a file)
+   * \param handovers impact of its handovers
+   */
+  void Add (const TpaNodeSummary &summary, const TpaHistogram &delay, const TpaHistogram &jitter,
+            const TpaLossRuns &lossRuns, const std::vector<TpaHandoverImpact> &handovers);
+  void Clear (void);
+
+  uint32_t GetNNodes (void) const;
+  const TpaNodeSummary & GetNode (uint32_t i) const;
+  uint64_t GetSent (void) const;
+  uint64_t GetReceived (void) const;
+  /// \return the packets lost by all the nodes / sent by all the nodes [%]
+  double GetLoss (void) const;
+  /// \return the sum of the throughput of the nodes [Kbps]
+  double GetThroughput (void) const;
+  /// \return the mean delay of all the packets [ms]
+  double GetDelay (void) const;
+  /// \return the mean jitter of all the samples [ms]
+  double GetJitter (void) const;
+  const TpaHistogram & GetDelayHistogram (void) const;
+  const TpaHistogram & GetJitterHistogram (void) const;
+  const TpaLossRuns & GetLossRuns (void) const;
+  /// \return the handovers of all the nodes, in the order of the nodes
+  const std::vector<TpaHandoverImpact> & GetHandovers (void) const;
+  /// \return the node of handover i
+  uint32_t GetHandoverNode (uint32_t i) const;
+
+  /// \return Jain's fairness index of the metric across the nodes, (sum x)^2 / (n sum x^2), 1 if all zero
+  double GetFairnessIndex (TpaNodeSummary::Metric metric) const;
+  static double GetFairnessIndex (const std::vector<double> &values);
+  /// \return the node with the worst value of the metric (the lowest throughput, the highest loss, ...)
+  uint32_t GetWorstNode (TpaNodeSummary::Metric metric) const;
+  /// \return the q quantile (0.0 to 1.0) of the metric across the nodes, nearest rank
+  double GetQuantile (TpaNodeSummary::Metric metric, double q) const;
+
+  /**
+   * Write one line, fields separated by separator:
+   * Nmn Ns Nr Th[Kbps] ThFair ThMin ThMed ThMax Pl[%] D[ms] D50 D99 J[ms] J99
+   * MOSmean MOSmin Nh L3[ms] O[ms] Nl WorstTh WorstPl WorstD99,
+   * L3 and O the means of the complete handovers and bounded outages, Nl
+   * the packets lost in the outages, Worst* the worst nodes
+   */
+  void Print (std::ostream &os, const std::string &separator) const;
+  /// Write one line per node: node number, then TpaNodeSummary::Print
+  void PrintNodes (std::ostream &os, const std::string &separator) const;
+
+private:
+  std::vector<double> GetValues (TpaNodeSummary::Metric metric) const;
+
+  std::vector<TpaNodeSummary>    m_nodes;
+  TpaHistogram                   m_delayHistogram;
+  TpaHistogram                   m_jitterHistogram;
+  TpaLossRuns                    m_lossRuns;
+  std::vector<TpaHandoverImpact> m_handovers;
+  std::vector<uint32_t>          m_handoverNodes;
+};
+
+} // namespace ns3
+
+#endif /* TPA_COLLECTOR_H */
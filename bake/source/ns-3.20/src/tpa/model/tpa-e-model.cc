@@ -0,0 +1,143 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Goran Shekerov <g_sekerov@yahoo.com>
+ */
+
+#include "tpa-e-model.h"
+#include <math.h>
+
+namespace ns3 {
+
+namespace {
+
+// G.113 Appendix I values; G.711 and G.722 with packet loss concealment, G.729 is G.729A + VAD.
+// Delays: 20 ms packets, G.729 two 10 ms frames + 5 ms look-ahead, G.722 1.5 ms look-ahead.
+const TpaCodecProfile g_codecs[] = {
+  { "G.711",  0.0, 25.1, 20.0, false },
+  { "G.729", 11.0, 19.0, 25.0, false },
+  { "G.722", 13.0, 10.0, 21.5, true }
+};
+const int N_CODECS = sizeof (g_codecs) / sizeof (g_codecs[0]);
+
+// G.107 default values of the parameters not measured by Tpa
+const double RO = 94.77;           // 15 - 1.5 (SLR + No), SLR = 8, No = -61.18
+const double IS = 1.41;            // from the default loudness ratios, sidetone and quantizing distortion
+const double RLR = 2.0;
+const double NO = -61.18;
+const double TELR = 65.0;
+const double WEPL = 110.0;
+const double RO_WIDEBAND = 129.0;  // G.107.1
+const double WIDEBAND_SCALE = 1.29;
+
+} // anonymous namespace
+
+TpaEModel::TpaEModel ()
+  : m_profile (&g_codecs[0])
+{
+}
+
+bool
+TpaEModel::SetCodec (const std::string &codec)
+{
+  for (int i = 0; i < N_CODECS; i++)
+    {
+      if (codec == g_codecs[i].name)
+        {
+          m_profile = &g_codecs[i];
+          return true;
+        }
+    }
+  return false;
+}
+
+std::string
+TpaEModel::GetCodec (void) const
+{
+  return m_profile->name;
+}
+
+const TpaCodecProfile &
+TpaEModel::GetProfile (void) const
+{
+  return *m_profile;
+}
+
+double
+TpaEModel::GetDelayImpairment (double delay) const
+{
+  double t = delay + m_profile->delay;   // T = Ta, mouth to ear
+  double tr = 2 * t;
+
+  // talker echo
+  double terv = TELR - 40 * log10 ((1 + t / 10) / (1 + t / 150)) + 6 * exp (-0.3 * t * t);
+  double re = 80 + 2.5 * (terv - 14);
+  double roe = -1.5 * (NO - RLR);
+  double idte = ((roe - re) / 2 + sqrt ((roe - re) * (roe - re) / 4 + 100) - 1) * (1 - exp (-t));
+
+  // listener echo
+  double rle = 10.5 * (WEPL + 7) * pow (tr + 1, -0.25);
+  double idle = (RO - rle) / 2 + sqrt ((RO - rle) * (RO - rle) / 4 + 169);
+
+  // absolute delay
+  double idd = 0.0;
+  if (t > 100)
+    {
+      double x = log10 (t / 100) / log10 (2.0);
+      idd = 25 * (pow (1 + pow (x, 6), 1.0 / 6) - 3 * pow (1 + pow (x / 3, 6), 1.0 / 6) + 2);
+    }
+  return idte + idle + idd;
+}
+
+double
+TpaEModel::GetEquipmentImpairment (double loss, double burstRatio) const
+{
+  double ie = m_profile->ie;
+  double ro = m_profile->wideband ? RO_WIDEBAND : 95.0;
+  if (loss <= 0.0)
+    {
+      return ie;
+    }
+  burstRatio = burstRatio < 1.0 ? 1.0 : burstRatio;
+  return ie + (ro - ie) * loss / (loss / burstRatio + m_profile->bpl);
+}
+
+double
+TpaEModel::GetR (double delay, double loss, double burstRatio) const
+{
+  double id = GetDelayImpairment (delay);
+  double ieEff = GetEquipmentImpairment (loss, burstRatio);
+  if (m_profile->wideband)
+    {
+      return (RO_WIDEBAND - WIDEBAND_SCALE * id - ieEff) / WIDEBAND_SCALE;
+    }
+  return RO - IS - id - ieEff;
+}
+
+double
+TpaEModel::GetMos (double r)
+{
+  if (r <= 0.0)
+    {
+      return 1.0;
+    }
+  if (r >= 100.0)
+    {
+      return 4.5;
+    }
+  return 1 + 0.035 * r + r * (r - 60) * (100 - r) * 7e-6;
+}
+
+} // namespace ns3
@@ -0,0 +1,92 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Goran Shekerov <g_sekerov@yahoo.com>
+ */
+
+#ifndef TPA_E_MODEL_H
+#define TPA_E_MODEL_H
+
+#include <string>
+
+namespace ns3 {
+
+/**
+ * \brief Codec parameters of the E-model
+ */
+struct TpaCodecProfile
+{
+  const char *name;
+  double ie;         //!< equipment impairment factor (Ie, or Ie,wb for wideband codecs)
+  double bpl;        //!< packet-loss robustness factor
+  double delay;      //!< packetization and look-ahead delay added to the network delay [ms]
+  bool   wideband;
+};
+
+/**
+ * \brief ITU-T G.107 E-model transmission rating
+ *
+ * R = Ro - Is - Id - Ie,eff + A, with the default values of all the
+ * parameters that are not measured (R = 93.2 without delay and loss):
+ *  - Id = Idte + Idle + Idd from the mean one-way delay T (Ta = T, Tr = 2T),
+ *    the codec delay added to it;
+ *  - Ie,eff = Ie + (95 - Ie) Ppl / (Ppl / BurstR + Bpl) with the Ie and Bpl
+ *    of the codec and the burst ratio of the losses (TpaLossRuns).
+ *
+ * Wideband codecs (G.722) are rated on the G.107.1 scale (Ro = 129) and
+ * the result divided by 1.29, so R and the MOS are always on the
+ * narrowband scale and comparable between codecs.
+ *
+ * No memory, no table lookup per call: a few log/pow/exp, cheap enough
+ * for every report interval of every flow.
+ */
+class TpaEModel
+{
+public:
+  TpaEModel ();
+
+  /**
+   * \param codec "G.711", "G.729" or "G.722"
+   * \return false, and the codec unchanged, if the name is unknown
+   */
+  bool SetCodec (const std::string &codec);
+  std::string GetCodec (void) const;
+  const TpaCodecProfile & GetProfile (void) const;
+
+  /// \return Id [R units] for the one-way network delay [ms]
+  double GetDelayImpairment (double delay) const;
+  /**
+   * \param loss packet loss [%]
+   * \param burstRatio 1 for random loss, above 1 for bursty loss
+   * \return Ie,eff [R units, scale of the codec]
+   */
+  double GetEquipmentImpairment (double loss, double burstRatio) const;
+  /**
+   * \param delay mean one-way network delay [ms]
+   * \param loss packet loss [%]
+   * \param burstRatio see GetEquipmentImpairment
+   * \return R, narrowband scale
+   */
+  double GetR (double delay, double loss, double burstRatio) const;
+  /// \return MOS (G.107 Annex B) of the narrowband R
+  static double GetMos (double r);
+
+private:
+  const TpaCodecProfile *m_profile;
+};
+
+} // namespace ns3
+
+#endif /* TPA_E_MODEL_H */
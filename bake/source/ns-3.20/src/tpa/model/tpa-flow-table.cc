@@ -0,0 +1,327 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Goran Shekerov <g_sekerov@yahoo.com>
+ */
+
+
+#include "tpa-flow-table.h"
+#include "ns3/ipv6-address.h"
+#include <cstring>
+#include <iomanip>
+
+namespace ns3 {
+
+TpaFlowKey::TpaFlowKey ()
+  : flowLabel (0),
+    sourcePort (0),
+    destinationPort (0),
+    protocol (0)
+{
+  std::memset (source, 0, sizeof (source));
+  std::memset (destination, 0, sizeof (destination));
+}
+
+uint32_t
+TpaFlowKey::Hash (void) const
+{
+  // FNV-1a over the fields
+  uint32_t hash = 2166136261U;
+  for (uint32_t i = 0; i < 16; i++)
+    {
+      hash = (hash ^ source[i]) * 16777619U;
+      hash = (hash ^ destination[i]) * 16777619U;
+    }
+  uint32_t rest[3] = { flowLabel, (uint32_t (sourcePort) << 16) | destinationPort, protocol };
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      for (uint32_t b = 0; b < 4; b++)
+        {
+          hash = (hash ^ ((rest[i] >> (8 * b)) & 0xff)) * 16777619U;
+        }
+    }
+  return hash;
+}
+
+void
+TpaFlowKey::Print (std::ostream &os) const
+{
+  os << Ipv6Address (source) << "." << sourcePort << " > "
+     << Ipv6Address (destination) << "." << destinationPort
+     << " " << uint32_t (protocol) << " " << flowLabel;
+}
+
+bool
+operator == (const TpaFlowKey &a, const TpaFlowKey &b)
+{
+  return a.flowLabel == b.flowLabel
+         && a.sourcePort == b.sourcePort
+         && a.destinationPort == b.destinationPort
+         && a.protocol == b.protocol
+         && std::memcmp (a.source, b.source, 16) == 0
+         && std::memcmp (a.destination, b.destination, 16) == 0;
+}
+
+TpaFlowStats::TpaFlowStats ()
+  : sent (0),
+    received (0),
+    reordered (0),
+    duplicates (0),
+    bytes (0),
+    firstReceived (0),
+    lastReceived (0),
+    lastDelay (0)
+{
+}
+
+double
+TpaFlowStats::GetThroughput (void) const
+{
+  if (received < 2 || lastReceived <= firstReceived)
+    {
+      return 0.0;
+    }
+  return (bytes * 8 / 1024) / (TpaNsToMs (lastReceived - firstReceived) / 1000); // [Kbps], same units as Tpa
+}
+
+double
+TpaFlowStats::GetPacketLossPercentage (void) const
+{
+  if (sent == 0)
+    {
+      return 0.0;
+    }
+  return (double (sent) - received) / sent * 100;
+}
+
+TpaFlowTable::TpaFlowTable ()
+  : m_mask (0),
+    m_windowSize (4096),
+    m_reorderWindowSize (1024),
+    m_lossGmin (16),
+    m_lastFlow (0)
+{
+}
+
+void
+TpaFlowTable::SetWindowSize (uint32_t size)
+{
+  m_windowSize = size;
+}
+
+uint32_t
+TpaFlowTable::GetWindowSize (void) const
+{
+  return m_windowSize;
+}
+
+void
+TpaFlowTable::SetReorderWindowSize (uint32_t size)
+{
+  m_reorderWindowSize = size;
+}
+
+uint32_t
+TpaFlowTable::GetReorderWindowSize (void) const
+{
+  return m_reorderWindowSize;
+}
+
+void
+TpaFlowTable::SetLossGmin (uint32_t gmin)
+{
+  m_lossGmin = gmin;
+}
+
+uint32_t
+TpaFlowTable::GetLossGmin (void) const
+{
+  return m_lossGmin;
+}
+
+uint32_t
+TpaFlowTable::GetFlow (const TpaFlowKey &key)
+{
+  if (m_lastFlow < m_keys.size () && m_keys[m_lastFlow] == key)
+    {
+      return m_lastFlow;
+    }
+
+  // keep the load factor under 0.5
+  if (2 * (m_keys.size () + 1) > m_slots.size ())
+    {
+      Grow ();
+    }
+
+  uint32_t hash = key.Hash ();
+  uint32_t slot = hash & m_mask;
+  while (m_slots[slot] != 0)
+    {
+      uint32_t flow = m_slots[slot] - 1;
+      if (m_hashes[flow] == hash && m_keys[flow] == key)
+        {
+          m_lastFlow = flow;
+          return flow;
+        }
+      slot = (slot + 1) & m_mask;
+    }
+
+  uint32_t flow = m_keys.size ();
+  m_slots[slot] = flow + 1;
+  m_hashes.push_back (hash);
+  m_keys.push_back (key);
+  m_stats.push_back (TpaFlowStats ());
+  m_windows.push_back (TpaSeqWindow (0));
+  m_reorderWindows.push_back (TpaReorderWindow (0));
+  m_lossRuns.push_back (TpaLossRuns ());
+  m_lossRuns.back ().SetGmin (m_lossGmin);
+  m_lastFlow = flow;
+  return flow;
+}
+
+void
+TpaFlowTable::Grow (void)
+{
+  uint32_t capacity = m_slots.empty () ? 16 : 2 * m_slots.size ();
+  m_slots.assign (capacity, 0);
+  m_mask = capacity - 1;
+  for (uint32_t flow = 0; flow < m_hashes.size (); flow++)
+    {
+      uint32_t slot = m_hashes[flow] & m_mask;
+      while (m_slots[slot] != 0)
+        {
+          slot = (slot + 1) & m_mask;
+        }
+      m_slots[slot] = flow + 1;
+    }
+}
+
+uint32_t
+TpaFlowTable::GetNFlows (void) const
+{
+  return m_keys.size ();
+}
+
+const TpaFlowKey &
+TpaFlowTable::GetKey (uint32_t flow) const
+{
+  return m_keys[flow];
+}
+
+TpaFlowStats &
+TpaFlowTable::GetStats (uint32_t flow)
+{
+  return m_stats[flow];
+}
+
+const TpaFlowStats &
+TpaFlowTable::GetStats (uint32_t flow) const
+{
+  return m_stats[flow];
+}
+
+TpaSeqWindow &
+TpaFlowTable::GetWindow (uint32_t flow)
+{
+  TpaSeqWindow &window = m_windows[flow];
+  if (window.GetSize () == 0)
+    {
+      window.SetSize (m_windowSize);
+    }
+  return window;
+}
+
+TpaReorderWindow &
+TpaFlowTable::GetReorderWindow (uint32_t flow)
+{
+  TpaReorderWindow &window = m_reorderWindows[flow];
+  if (window.GetSize () == 0)
+    {
+      window.SetSize (m_reorderWindowSize);
+    }
+  return window;
+}
+
+TpaLossRuns &
+TpaFlowTable::GetLossRuns (uint32_t flow)
+{
+  return m_lossRuns[flow];
+}
+
+const TpaLossRuns &
+TpaFlowTable::GetLossRuns (uint32_t flow) const
+{
+  return m_lossRuns[flow];
+}
+
+bool
+TpaFlowTable::AddDelay (uint32_t flow, int64_t delay, int64_t &jitter)
+{
+  TpaFlowStats &stats = m_stats[flow];
+  bool haveJitter = stats.delay.GetCount () > 0;
+  if (haveJitter)
+    {
+      jitter = delay > stats.lastDelay ? delay - stats.lastDelay : stats.lastDelay - delay;
+    }
+  AddSample (flow, delay, jitter, haveJitter);
+  return haveJitter;
+}
+
+void
+TpaFlowTable::AddSample (uint32_t flow, int64_t delay, int64_t jitter, bool haveJitter)
+{
+  TpaFlowStats &stats = m_stats[flow];
+  if (haveJitter)
+    {
+      stats.jitter.Add (TpaNsToMs (jitter));
+    }
+  stats.delay.Add (TpaNsToMs (delay));
+  stats.lastDelay = delay;
+}
+
+void
+TpaFlowTable::Print (std::ostream &os, const char *separator) const
+{
+  for (uint32_t flow = 0; flow < m_keys.size (); flow++)
+    {
+      const TpaFlowStats &stats = m_stats[flow];
+      m_keys[flow].Print (os);
+      os << separator << std::fixed << std::setprecision (2) << stats.GetThroughput ();
+      os << separator << stats.GetPacketLossPercentage ();
+      os << separator << stats.delay.GetMean ();
+      os << separator << stats.jitter.GetMean ();
+      os << separator << stats.sent;
+      os << separator << stats.received;
+      os << separator << stats.reordered;
+      os << separator << stats.duplicates;
+      os << std::endl;
+    }
+}
+
+void
+TpaFlowTable::Clear (void)
+{
+  m_slots.clear ();
+  m_hashes.clear ();
+  m_keys.clear ();
+  m_stats.clear ();
+  m_windows.clear ();
+  m_reorderWindows.clear ();
+  m_lossRuns.clear ();
+  m_mask = 0;
+  m_lastFlow = 0;
+}
+
+} // namespace ns3
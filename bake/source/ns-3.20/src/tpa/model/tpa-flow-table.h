@@ -0,0 +1,182 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Goran Shekerov <g_sekerov@yahoo.com>
+ */
+
+
+#ifndef TPA_FLOW_TABLE_H
+#define TPA_FLOW_TABLE_H
+
+#include <stdint.h>
+#include <vector>
+#include <deque>
+#include <iostream>
+#include "tpa-running-stats.h"
+#include "tpa-seq-window.h"
+#include "tpa-reorder-window.h"
+#include "tpa-loss-runs.h"
+#include "tpa-time.h"
+
+namespace ns3 {
+
+/**
+ * \brief Identifies a flow: addresses, ports, protocol and IPv6 flow label
+ *
+ * The addresses are the home addresses when the packet carries them (Type 2
+ * Routing header, Home Address option) or the inner-most IPv6 addresses, so
+ * a flow keeps its identity when the MN moves between the home link,
+ * the HA tunnel and route optimization.
+ */
+struct TpaFlowKey
+{
+  uint8_t  source[16];
+  uint8_t  destination[16];
+  uint32_t flowLabel;
+  uint16_t sourcePort;      //!< UDP/TCP ports, 0 for other protocols
+  uint16_t destinationPort;
+  uint8_t  protocol;
+
+  TpaFlowKey ();
+  uint32_t Hash (void) const;
+  /// "src.port > dst.port proto label"
+  void Print (std::ostream &os) const;
+};
+
+bool operator == (const TpaFlowKey &a, const TpaFlowKey &b);
+
+/**
+ * \brief Per-flow counters and delay/jitter accumulators
+ *
+ * Kept small and contiguous (one array for all flows) because it is
+ * updated on every loaded packet.
+ */
+struct TpaFlowStats
+{
+  uint32_t sent;
+  uint32_t received;
+  uint32_t reordered;       //!< received out of order (TpaReorderWindow)
+  uint32_t duplicates;      //!< received again, counted in received too
+  uint64_t bytes;           //!< received bytes
+  int64_t  firstReceived;   //!< [ns]
+  int64_t  lastReceived;    //!< [ns]
+  int64_t  lastDelay;       //!< [ns]
+  TpaRunningStats delay;    //!< [ms]
+  TpaRunningStats jitter;   //!< [ms]
+
+  TpaFlowStats ();
+  /// \return received throughput [Kbps], 0 with less than two received packets
+  double GetThroughput (void) const;
+  /// \return packet loss [%], 0 when nothing was sent through this analyzer
+  double GetPacketLossPercentage (void) const;
+};
+
+/**
+ * \brief Flat hash table of flows
+ *
+ * Open addressing with linear probing over an array of flow indexes; the
+ * keys, the hot statistics and the in-flight windows are kept in three
+ * separate arrays indexed by flow number, so a lookup touches the slot
+ * array and (to confirm the match) one key, and the update touches one
+ * TpaFlowStats.  The last flow found is remembered, consecutive packets
+ * of the same flow skip the probe.
+ *
+ * Tpa writes one line per flow next to its result line (tempflows.txt);
+ * in streaming mode every flow has its own in-flight window.
+ */
+class TpaFlowTable
+{
+public:
+  TpaFlowTable ();
+
+  /**
+   * \param size in-flight window of each flow (see TpaSeqWindow);
+   *        applies to the flows created afterwards
+   */
+  void SetWindowSize (uint32_t size);
+  uint32_t GetWindowSize (void) const;
+  /**
+   * \param size reorder window of each flow (see TpaReorderWindow);
+   *        applies to the flows created afterwards
+   */
+  void SetReorderWindowSize (uint32_t size);
+  uint32_t GetReorderWindowSize (void) const;
+  /**
+   * \param gmin see TpaLossRuns::SetGmin; applies to the flows created afterwards
+   */
+  void SetLossGmin (uint32_t gmin);
+  uint32_t GetLossGmin (void) const;
+
+  /**
+   * \return the number of the flow, a new flow is created the first time a key is seen
+   */
+  uint32_t GetFlow (const TpaFlowKey &key);
+  uint32_t GetNFlows (void) const;
+  const TpaFlowKey & GetKey (uint32_t flow) const;
+  TpaFlowStats & GetStats (uint32_t flow);
+  const TpaFlowStats & GetStats (uint32_t flow) const;
+  /**
+   * \return the in-flight window of the flow, allocated on first use
+   */
+  TpaSeqWindow & GetWindow (uint32_t flow);
+  /**
+   * \return the reorder window of the flow, allocated on first use
+   */
+  TpaReorderWindow & GetReorderWindow (uint32_t flow);
+  TpaLossRuns & GetLossRuns (uint32_t flow);
+  const TpaLossRuns & GetLossRuns (uint32_t flow) const;
+
+  /**
+   * Add a delay sample to the flow; the jitter is the difference with the
+   * previous delay of the same flow, an exact integer difference
+   * \param delay [ns]
+   * \param jitter set to the jitter sample [ns]
+   * \return true if a jitter sample was produced (not for the first delay)
+   */
+  bool AddDelay (uint32_t flow, int64_t delay, int64_t &jitter);
+  /**
+   * Add a delay sample whose jitter is already taken (buffered mode, by column)
+   * \param jitter [ns], ignored without haveJitter
+   */
+  void AddSample (uint32_t flow, int64_t delay, int64_t jitter, bool haveJitter);
+
+  /**
+   * Write one line per flow: key, throughput, loss, mean delay, mean jitter, sent, received,
+   * reordered, duplicates
+   * \param separator put between the fields
+   */
+  void Print (std::ostream &os, const char *separator) const;
+  void Clear (void);
+
+private:
+  void Grow (void);
+
+  std::vector<uint32_t>     m_slots;      // flow number + 1, 0 for an empty slot
+  std::vector<uint32_t>     m_hashes;     // hash of every flow, to grow without rehashing keys
+  std::vector<TpaFlowKey>   m_keys;
+  std::vector<TpaFlowStats> m_stats;
+  std::deque<TpaSeqWindow>  m_windows;
+  std::deque<TpaReorderWindow> m_reorderWindows;
+  std::deque<TpaLossRuns>   m_lossRuns;
+  uint32_t m_mask;
+  uint32_t m_windowSize;
+  uint32_t m_reorderWindowSize;
+  uint32_t m_lossGmin;
+  uint32_t m_lastFlow;                    // last flow found, checked first
+};
+
+} // namespace ns3
+
+#endif /* TPA_FLOW_TABLE_H */
@@ -0,0 +1,367 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Goran Shekerov <g_sekerov@yahoo.com>
+ */
+
+
+#include "tpa-handover-detector.h"
+#include "tpa-ipv6-walker.h"
+#include <cstring>
+#include <iomanip>
+
+namespace ns3 {
+
+namespace {
+
+// 802.11 frame control
+const uint8_t  WIFI_TYPE_MANAGEMENT = 0;
+const uint8_t  WIFI_TYPE_DATA = 2;
+const uint8_t  WIFI_ASSOC_REQUEST = 0;
+const uint8_t  WIFI_ASSOC_RESPONSE = 1;
+const uint8_t  WIFI_REASSOC_REQUEST = 2;
+const uint8_t  WIFI_REASSOC_RESPONSE = 3;
+const uint8_t  WIFI_TO_DS = 0x01;
+const uint8_t  WIFI_FROM_DS = 0x02;
+const uint32_t WIFI_HEADER_SIZE = 24;
+const uint32_t WIFI_ADDR1_OFFSET = 4;
+const uint32_t WIFI_ADDR2_OFFSET = 10;
+const uint32_t ASSOC_STATUS_OFFSET = 2;    // after the capabilities
+const uint32_t LLC_SNAP_SIZE = 8;
+
+// ICMPv6 and Mobility header
+const uint8_t  ICMPV6 = 58;
+const uint8_t  MOBILITY_HEADER = 135;
+const uint8_t  ICMPV6_RS = 133;
+const uint8_t  ICMPV6_RA = 134;
+const uint8_t  ICMPV6_NS = 135;
+const uint8_t  MH_BINDING_UPDATE = 5;
+const uint8_t  MH_BINDING_ACK = 6;
+const uint32_t MH_TYPE_OFFSET = 2;
+const uint32_t BU_SEQUENCE_OFFSET = 6;
+const uint32_t BU_FLAGS_OFFSET = 8;
+const uint32_t BU_LIFETIME_OFFSET = 10;
+const uint8_t  BU_HOME_REGISTRATION = 0x40;
+const uint32_t BA_STATUS_OFFSET = 6;
+const uint32_t BA_SEQUENCE_OFFSET = 8;
+const uint8_t  BA_ACCEPTED_LIMIT = 128;    // status codes below 128 accept the binding
+const uint32_t IPV6_SOURCE_OFFSET = 8;
+
+} // anonymous namespace
+
+TpaHandover::TpaHandover ()
+  : l2Start (-1.0),
+    l2Done (-1.0),
+    rs (-1.0),
+    ra (-1.0),
+    dad (-1.0),
+    bu (-1.0),
+    ba (-1.0),
+    buSequence (0),
+    home (false)
+{
+}
+
+bool
+TpaHandover::IsComplete (void) const
+{
+  return l2Done >= 0.0 && ba >= 0.0;
+}
+
+static double
+Difference (double end, double start)
+{
+  return end >= 0.0 && start >= 0.0 ? end - start : 0.0;
+}
+
+double
+TpaHandover::GetL2Delay (void) const
+{
+  return Difference (l2Done, l2Start);
+}
+
+double
+TpaHandover::GetMovementDetectionDelay (void) const
+{
+  return Difference (ra, l2Done);
+}
+
+double
+TpaHandover::GetAddressConfigurationDelay (void) const
+{
+  return Difference (bu, ra);
+}
+
+double
+TpaHandover::GetRegistrationDelay (void) const
+{
+  return Difference (ba, bu);
+}
+
+double
+TpaHandover::GetL3Delay (void) const
+{
+  return Difference (ba, l2Done);
+}
+
+TpaHandoverDetector::TpaHandoverDetector ()
+  : m_state (IDLE),
+    m_haveAddress (false),
+    m_associated (false)
+{
+  std::memset (m_address, 0, sizeof (m_address));
+}
+
+void
+TpaHandoverDetector::SetMobileNodeAddress (const uint8_t address[6])
+{
+  std::memcpy (m_address, address, 6);
+  m_haveAddress = true;
+}
+
+void
+TpaHandoverDetector::LoadFrame (const TpaPacketView &view, double timeNow, bool sent)
+{
+  if (!view.Has (0, WIFI_HEADER_SIZE))
+    {
+      return;
+    }
+  uint8_t control = view.ReadU8 (0);
+  uint8_t flags = view.ReadU8 (1);
+  uint8_t type = (control >> 2) & 0x03;
+  uint8_t subtype = control >> 4;
+
+  if (sent)
+    {
+      if (!m_haveAddress)
+        {
+          SetMobileNodeAddress (view.PeekData (WIFI_ADDR2_OFFSET));
+        }
+    }
+  else if (m_haveAddress)
+    {
+      // the PHY of the MN also hears the frames of the other stations
+      const uint8_t *addr1 = view.PeekData (WIFI_ADDR1_OFFSET);
+      if ((addr1[0] & 0x01) == 0 && std::memcmp (addr1, m_address, 6) != 0)
+        {
+          return;
+        }
+    }
+
+  if (type == WIFI_TYPE_MANAGEMENT)
+    {
+      LoadManagement (view, subtype, timeNow, sent);
+    }
+  else if (type == WIFI_TYPE_DATA && (subtype & 0x04) == 0) // not a null data frame
+    {
+      uint32_t offset = WIFI_HEADER_SIZE;
+      if ((flags & WIFI_TO_DS) && (flags & WIFI_FROM_DS))
+        {
+          offset = offset + 6;                    // fourth address
+        }
+      if (subtype & 0x08)
+        {
+          offset = offset + 2;                    // QoS control
+        }
+      if (view.Has (offset, LLC_SNAP_SIZE + 1) && view.ReadU8 (offset) == 0xaa
+          && view.ReadNtohU16 (offset + 6) == 0x86dd)
+        {
+          LoadIpv6 (view, offset + LLC_SNAP_SIZE, timeNow, sent);
+        }
+    }
+}
+
+void
+TpaHandoverDetector::LoadManagement (const TpaPacketView &view, uint8_t subtype, double timeNow, bool sent)
+{
+  if (sent && (subtype == WIFI_ASSOC_REQUEST || subtype == WIFI_REASSOC_REQUEST))
+    {
+      if (m_associated && m_state != ASSOCIATING)
+        {
+          Begin ();
+          m_current.l2Start = timeNow;
+          m_state = ASSOCIATING;
+        }
+      return;
+    }
+  if (!sent && (subtype == WIFI_ASSOC_RESPONSE || subtype == WIFI_REASSOC_RESPONSE))
+    {
+      uint32_t status = WIFI_HEADER_SIZE + ASSOC_STATUS_OFFSET;
+      if (!view.Has (status, 2) || view.ReadU8 (status) != 0 || view.ReadU8 (status + 1) != 0)
+        {
+          return;                                 // refused, still associating
+        }
+      if (!m_associated)
+        {
+          m_associated = true;                    // attach at the start, not a handover
+          return;
+        }
+      if (m_state != ASSOCIATING)
+        {
+          Begin ();                               // the request was not seen
+        }
+      m_current.l2Done = timeNow;
+      m_state = ASSOCIATED;
+    }
+}
+
+void
+TpaHandoverDetector::LoadIpv6 (const TpaPacketView &view, uint32_t offset, double timeNow, bool sent)
+{
+  if (m_state == IDLE || m_state == ASSOCIATING)
+    {
+      return;                                     // refreshes, traffic: not a handover
+    }
+  TpaIpv6Path path;
+  if (!TpaIpv6Walker::Walk (view, offset, path))
+    {
+      return;
+    }
+
+  if (path.protocol == ICMPV6 && view.Has (path.offset, 1))
+    {
+      uint8_t type = view.ReadU8 (path.offset);
+      if (sent && type == ICMPV6_RS && m_current.rs < 0.0)
+        {
+          m_current.rs = timeNow;
+        }
+      else if (!sent && type == ICMPV6_RA && m_state == ASSOCIATED)
+        {
+          m_current.ra = timeNow;
+          m_state = MOVEMENT_DETECTED;
+        }
+      else if (sent && type == ICMPV6_NS && m_current.dad < 0.0 && m_state == MOVEMENT_DETECTED)
+        {
+          // DAD probes are sent from the unspecified address
+          static const uint8_t unspecified[16] = { 0 };
+          if (std::memcmp (view.PeekData (path.ipv6Offset + IPV6_SOURCE_OFFSET), unspecified, 16) == 0)
+            {
+              m_current.dad = timeNow;
+              m_state = DAD;
+            }
+        }
+      return;
+    }
+
+  if (path.protocol != MOBILITY_HEADER || !view.Has (path.offset, BU_LIFETIME_OFFSET + 2))
+    {
+      return;
+    }
+  uint8_t type = view.ReadU8 (path.offset + MH_TYPE_OFFSET);
+  if (sent && type == MH_BINDING_UPDATE && (view.ReadU8 (path.offset + BU_FLAGS_OFFSET) & BU_HOME_REGISTRATION))
+    {
+      if (m_current.bu < 0.0)
+        {
+          m_current.bu = timeNow;
+        }
+      m_current.buSequence = view.ReadNtohU16 (path.offset + BU_SEQUENCE_OFFSET); // retransmissions change it
+      m_current.home = view.ReadNtohU16 (path.offset + BU_LIFETIME_OFFSET) == 0;
+      m_state = BINDING;
+    }
+  else if (!sent && type == MH_BINDING_ACK && m_state == BINDING
+           && view.ReadU8 (path.offset + BA_STATUS_OFFSET) < BA_ACCEPTED_LIMIT
+           && view.ReadNtohU16 (path.offset + BA_SEQUENCE_OFFSET) == m_current.buSequence)
+    {
+      m_current.ba = timeNow;
+      Finish ();
+    }
+}
+
+void
+TpaHandoverDetector::Begin (void)
+{
+  if (m_state != IDLE)
+    {
+      Finish ();                                  // abandoned, e.g. ping-pong before the BA
+    }
+  m_current = TpaHandover ();
+}
+
+void
+TpaHandoverDetector::Finish (void)
+{
+  m_handovers.push_back (m_current);
+  m_current = TpaHandover ();
+  m_state = IDLE;
+}
+
+uint32_t
+TpaHandoverDetector::GetNHandovers (void) const
+{
+  return m_handovers.size ();
+}
+
+const TpaHandover &
+TpaHandoverDetector::GetHandover (uint32_t i) const
+{
+  return m_handovers[i];
+}
+
+const TpaHandover *
+TpaHandoverDetector::GetLastComplete (void) const
+{
+  for (uint32_t i = m_handovers.size (); i > 0; i--)
+    {
+      if (m_handovers[i - 1].IsComplete ())
+        {
+          return &m_handovers[i - 1];
+        }
+    }
+  return 0;
+}
+
+bool
+TpaHandoverDetector::IsInProgress (void) const
+{
+  return m_state != IDLE;
+}
+
+const TpaHandover &
+TpaHandoverDetector::GetCurrent (void) const
+{
+  return m_current;
+}
+
+void
+TpaHandoverDetector::Print (std::ostream &os) const
+{
+  for (uint32_t i = 0; i < m_handovers.size (); i++)
+    {
+      const TpaHandover &h = m_handovers[i];
+      os << "Handover " << i + 1 << (h.home ? " (home)" : "") << " at " << std::fixed << std::setprecision (3)
+         << h.l2Done / 1000 << " s: ";
+      if (!h.IsComplete ())
+        {
+          os << "not completed" << std::endl;
+          continue;
+        }
+      os << std::setprecision (2)
+         << "L2 " << h.GetL2Delay ()
+         << " ms, movement detection " << h.GetMovementDetectionDelay ()
+         << " ms, address configuration " << h.GetAddressConfigurationDelay ()
+         << " ms, registration " << h.GetRegistrationDelay ()
+         << " ms, L3 " << h.GetL3Delay () << " ms" << std::endl;
+    }
+}
+
+void
+TpaHandoverDetector::Clear (void)
+{
+  m_state = IDLE;
+  m_current = TpaHandover ();
+  m_handovers.clear ();
+}
+
+} // namespace ns3
@@ -0,0 +1,130 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Goran Shekerov <g_sekerov@yahoo.com>
+ */
+
+
+#ifndef TPA_HANDOVER_DETECTOR_H
+#define TPA_HANDOVER_DETECTOR_H
+
+#include <stdint.h>
+#include <vector>
+#include <iostream>
+#include "tpa-packet-view.h"
+
+namespace ns3 {
+
+/**
+ * \brief Phase time stamps of one MIPv6 handover [ms], -1 when not seen
+ */
+struct TpaHandover
+{
+  double   l2Start;        //!< (Re)Association Request sent by the MN
+  double   l2Done;         //!< successful (Re)Association Response received
+  double   rs;             //!< first Router Solicitation sent after the association
+  double   ra;             //!< first Router Advertisement received, movement detected
+  double   dad;            //!< first DAD Neighbor Solicitation sent (source ::)
+  double   bu;             //!< first home Binding Update sent
+  double   ba;             //!< accepted Binding Acknowledgement received, handover done
+  uint16_t buSequence;
+  bool     home;           //!< the BU deregisters (lifetime 0), the MN is back home
+
+  TpaHandover ();
+  bool IsComplete (void) const;
+  /// \return association time, l2Done - l2Start
+  double GetL2Delay (void) const;
+  /// \return movement detection time, ra - l2Done
+  double GetMovementDetectionDelay (void) const;
+  /// \return address configuration time (DAD), bu - ra
+  double GetAddressConfigurationDelay (void) const;
+  /// \return registration time, ba - bu
+  double GetRegistrationDelay (void) const;
+  /// \return L3 handover time, ba - l2Done (the legacy H column)
+  double GetL3Delay (void) const;
+};
+
+/**
+ * \brief Protocol-aware handover state machine
+ *
+ * Fed with the 802.11 frames seen by the PHY of the MN, both received and
+ * sent, it parses the management frames, the ICMPv6 RS/RA/NS and the
+ * Mobility header BU/BA carried in the data frames (TpaIpv6Walker), and
+ * follows every handover through its phases:
+ *
+ *   IDLE -> ASSOCIATING -> ASSOCIATED -> MOVEMENT_DETECTED -> DAD -> BINDING -> IDLE
+ *
+ * The first association of the MN (its attach at the start of the run, at
+ * home or not) is not a handover: no earlier association, nothing to hand
+ * over from.  Nothing depends on the frame sizes, the addresses or the time; received
+ * frames are only checked to be addressed to the MN, whose MAC address is
+ * learnt from its first sent frame (or set).  The handovers are kept in a
+ * vector, nothing is allocated per frame.
+ */
+class TpaHandoverDetector
+{
+public:
+  TpaHandoverDetector ();
+
+  void SetMobileNodeAddress (const uint8_t address[6]);
+  /**
+   * \param view the frame, from the 802.11 MAC header
+   * \param timeNow [ms]
+   * \param sent true for a frame sent by the MN, false for a received one
+   */
+  void LoadFrame (const TpaPacketView &view, double timeNow, bool sent);
+
+  /// \return the number of finished handovers, complete or abandoned
+  uint32_t GetNHandovers (void) const;
+  const TpaHandover & GetHandover (uint32_t i) const;
+  /// \return the last complete handover, 0 if none
+  const TpaHandover * GetLastComplete (void) const;
+  /// \return true while a handover is not finished
+  bool IsInProgress (void) const;
+  /// \return the handover not finished yet, only meaningful while IsInProgress
+  const TpaHandover & GetCurrent (void) const;
+
+  /// one line per handover with its phases [ms]
+  void Print (std::ostream &os) const;
+  /// Forget the handovers, the MN stays associated
+  void Clear (void);
+
+private:
+  enum State
+  {
+    IDLE,
+    ASSOCIATING,
+    ASSOCIATED,
+    MOVEMENT_DETECTED,
+    DAD,
+    BINDING
+  };
+
+  void LoadManagement (const TpaPacketView &view, uint8_t subtype, double timeNow, bool sent);
+  void LoadIpv6 (const TpaPacketView &view, uint32_t offset, double timeNow, bool sent);
+  void Begin (void);
+  void Finish (void);
+
+  State       m_state;
+  TpaHandover m_current;
+  std::vector<TpaHandover> m_handovers;
+  uint8_t     m_address[6];
+  bool        m_haveAddress;
+  bool        m_associated;     // an association completed, the next one is a handover
+};
+
+} // namespace ns3
+
+#endif /* TPA_HANDOVER_DETECTOR_H */
@@ -0,0 +1,392 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Goran Shekerov <g_sekerov@yahoo.com>
+ */
+
+#include "tpa-handover-timeline.h"
+#include <math.h>
+
+namespace ns3 {
+
+TpaHandoverImpact::TpaHandoverImpact ()
+  : start (-1.0),
+    end (-1.0),
+    l3Delay (-1.0),
+    outageStart (-1.0),
+    outageEnd (-1.0),
+    outageSent (0),
+    outageDelivered (0)
+{
+  for (int i = 0; i < 3; i++)
+    {
+      delay[i] = -1.0;
+      jitter[i] = -1.0;
+    }
+}
+
+double
+TpaHandoverImpact::GetOutage (void) const
+{
+  if (outageStart < 0.0 || outageEnd < 0.0)
+    {
+      return -1.0;
+    }
+  return outageEnd - outageStart;
+}
+
+uint32_t
+TpaHandoverImpact::GetLost (void) const
+{
+  return outageSent > outageDelivered ? outageSent - outageDelivered : 0;
+}
+
+void
+TpaHandoverImpact::Print (std::ostream &os, const std::string &separator) const
+{
+  os << separator << start / 1000;
+  os << separator << l3Delay;
+  os << separator << GetOutage ();
+  os << separator << GetLost ();
+  for (int i = 0; i < 3; i++)
+    {
+      os << separator << delay[i];
+    }
+  for (int i = 0; i < 3; i++)
+    {
+      os << separator << jitter[i];
+    }
+}
+
+TpaHandoverTimeline::TpaHandoverTimeline ()
+  : m_slotWidth (10.0),
+    m_window (1000.0),
+    m_maxDuration (10000.0)
+{
+  Clear ();
+}
+
+void
+TpaHandoverTimeline::SetSlotWidth (double width)
+{
+  m_slotWidth = width;
+  m_slots.clear ();
+  m_firstSlot = 0;
+  m_lastSlot = -1;
+}
+
+double
+TpaHandoverTimeline::GetSlotWidth (void) const
+{
+  return m_slotWidth;
+}
+
+void
+TpaHandoverTimeline::SetWindow (double window)
+{
+  m_window = window;
+}
+
+double
+TpaHandoverTimeline::GetWindow (void) const
+{
+  return m_window;
+}
+
+void
+TpaHandoverTimeline::SetMaxDuration (double duration)
+{
+  m_maxDuration = duration;
+}
+
+double
+TpaHandoverTimeline::GetMaxDuration (void) const
+{
+  return m_maxDuration;
+}
+
+void
+TpaHandoverTimeline::Begin (double timeNow)
+{
+  Outage outage;
+  outage.start = timeNow;
+  outage.outageStart = m_lastReceived;
+  outage.outageEnd = -1.0;
+  outage.sent = m_sentSinceReceived;  // the link may have been lost before the handover started
+  outage.delivered = 0;
+  outage.phaseEnd = -1.0;
+  outage.finished = false;
+  outage.closed = false;
+  m_outages.push_back (outage);
+}
+
+void
+TpaHandoverTimeline::Finish (uint32_t i, const TpaHandover &handover)
+{
+  if (i < m_outages.size () && !m_outages[i].closed)   // closed after MaxDuration: its end is kept
+    {
+      m_outages[i].phaseEnd = GetPhaseEnd (handover);
+      m_outages[i].finished = true;
+    }
+}
+
+void
+TpaHandoverTimeline::AddSent (double)
+{
+  m_sentSinceReceived = m_sentSinceReceived + 1;
+  for (uint32_t i = m_firstOpen; i < m_outages.size (); i++)
+    {
+      m_outages[i].sent = m_outages[i].sent + 1;
+    }
+}
+
+void
+TpaHandoverTimeline::AddReceived (double timeNow)
+{
+  m_lastReceived = timeNow;
+  m_sentSinceReceived = 0;
+  for (uint32_t i = m_firstOpen; i < m_outages.size (); i++)
+    {
+      m_outages[i].outageEnd = timeNow;
+    }
+  m_firstOpen = m_outages.size ();
+}
+
+void
+TpaHandoverTimeline::AddDelay (double sentTime, double receivedTime, double delay, double jitter)
+{
+  int64_t slot = GetSlot (receivedTime);
+  if (slot > m_lastSlot)
+    {
+      m_lastSlot = slot;
+      Release (receivedTime);
+    }
+  if (slot >= m_firstSlot)    // older ones are not needed anymore
+    {
+      if (slot - m_firstSlot >= int64_t (m_slots.size ()))
+        {
+          Slot empty = { 0.0, 0.0, 0, 0 };
+          m_slots.resize (slot - m_firstSlot + 1, empty);
+        }
+      Slot &s = m_slots[slot - m_firstSlot];
+      s.delaySum = s.delaySum + delay;
+      s.delays = s.delays + 1;
+      if (jitter >= 0.0)
+        {
+          s.jitterSum = s.jitterSum + jitter;
+          s.jitters = s.jitters + 1;
+        }
+    }
+
+  // the outages are in time order: binary search for the last one started before the packet,
+  // then back over the handovers sharing it
+  uint32_t low = 0;
+  uint32_t high = m_outages.size ();
+  while (low < high)
+    {
+      uint32_t middle = (low + high) / 2;
+      if (m_outages[middle].outageStart < sentTime)
+        {
+          low = middle + 1;
+        }
+      else
+        {
+          high = middle;
+        }
+    }
+  for (uint32_t i = low; i > 0; i--)
+    {
+      Outage &outage = m_outages[i - 1];
+      if (outage.outageStart < 0.0 || outage.outageStart != m_outages[low - 1].outageStart)
+        {
+          break;
+        }
+      if (outage.outageEnd >= 0.0 && sentTime >= outage.outageEnd)
+        {
+          break;
+        }
+      outage.delivered = outage.delivered + 1;
+    }
+}
+
+uint32_t
+TpaHandoverTimeline::GetNHandovers (void) const
+{
+  return m_outages.size ();
+}
+
+uint32_t
+TpaHandoverTimeline::GetNSlots (void) const
+{
+  return m_slots.size ();
+}
+
+TpaHandoverImpact
+TpaHandoverTimeline::GetImpact (uint32_t i, const TpaHandover &handover) const
+{
+  const Outage &outage = m_outages[i];
+  TpaHandoverImpact impact;
+  impact.start = outage.start;
+  impact.l3Delay = handover.IsComplete () ? handover.GetL3Delay () : -1.0;
+  impact.outageStart = outage.outageStart;
+  impact.outageEnd = outage.outageEnd;
+  impact.outageSent = outage.sent;
+  impact.outageDelivered = outage.delivered;
+  impact.end = GetEnd (outage, outage.finished || outage.closed ? outage.phaseEnd : GetPhaseEnd (handover));
+  if (outage.closed)
+    {
+      for (int k = 0; k < 3; k++)
+        {
+          impact.delay[k] = outage.delay[k];
+          impact.jitter[k] = outage.jitter[k];
+        }
+    }
+  else
+    {
+      GetWindows (outage, impact.end, impact.delay, impact.jitter);
+    }
+  return impact;
+}
+
+void
+TpaHandoverTimeline::Clear (void)
+{
+  m_lastReceived = -1.0;
+  m_sentSinceReceived = 0;
+  m_firstOpen = 0;
+  m_firstKept = 0;
+  m_firstSlot = 0;
+  m_lastSlot = -1;
+  m_outages.clear ();
+  m_slots.clear ();
+}
+
+int64_t
+TpaHandoverTimeline::GetSlot (double time) const
+{
+  return int64_t (floor (time / m_slotWidth));
+}
+
+void
+TpaHandoverTimeline::GetMeans (int64_t first, int64_t last, double &delay, double &jitter) const
+{
+  // slots [first, last], the ones not kept are empty
+  double delaySum = 0.0;
+  double jitterSum = 0.0;
+  uint32_t delays = 0;
+  uint32_t jitters = 0;
+  first = first < m_firstSlot ? m_firstSlot : first;
+  last = last >= m_firstSlot + int64_t (m_slots.size ()) ? m_firstSlot + int64_t (m_slots.size ()) - 1 : last;
+  for (int64_t slot = first; slot <= last; slot++)
+    {
+      const Slot &s = m_slots[slot - m_firstSlot];
+      delaySum = delaySum + s.delaySum;
+      jitterSum = jitterSum + s.jitterSum;
+      delays = delays + s.delays;
+      jitters = jitters + s.jitters;
+    }
+  delay = delays > 0 ? delaySum / delays : -1.0;
+  jitter = jitters > 0 ? jitterSum / jitters : -1.0;
+}
+
+void
+TpaHandoverTimeline::GetWindows (const Outage &outage, double end, double delay[3], double jitter[3]) const
+{
+  int64_t first = GetSlot (outage.start);
+  int64_t last = GetSlot (end);
+  GetMeans (GetSlot (outage.start - m_window), first - 1,
+            delay[TpaHandoverImpact::BEFORE], jitter[TpaHandoverImpact::BEFORE]);
+  GetMeans (first, last, delay[TpaHandoverImpact::DURING], jitter[TpaHandoverImpact::DURING]);
+  GetMeans (last + 1, GetSlot (end + m_window), delay[TpaHandoverImpact::AFTER], jitter[TpaHandoverImpact::AFTER]);
+}
+
+double
+TpaHandoverTimeline::GetPhaseEnd (const TpaHandover &handover)
+{
+  double end = handover.ba;
+  if (end < 0.0)
+    {
+      const double phases[6] = { handover.l2Start, handover.l2Done, handover.rs,
+                                 handover.ra, handover.dad, handover.bu };
+      for (int k = 0; k < 6; k++)
+        {
+          end = phases[k] > end ? phases[k] : end;
+        }
+    }
+  return end;
+}
+
+double
+TpaHandoverTimeline::GetEnd (const Outage &outage, double phaseEnd) const
+{
+  // at most MaxDuration after the start, but at least the end of the outage
+  // and the start
+  double limit = outage.start + m_maxDuration;
+  phaseEnd = phaseEnd > limit ? limit : phaseEnd;
+  double end = outage.outageEnd > phaseEnd ? outage.outageEnd : phaseEnd;
+  return outage.start > end ? outage.start : end;
+}
+
+void
+TpaHandoverTimeline::Release (double receivedTime)
+{
+  // a handover is closed when it is finished (or MaxDuration old), its
+  // outage is over (a packet was received after its start, it is loaded
+  // before its delay) and the delays have passed its window after; the
+  // handovers start in time order
+  for (uint32_t i = m_firstKept; i < m_outages.size () && GetSlot (m_outages[i].start) <= m_lastSlot; i++)
+    {
+      Outage &outage = m_outages[i];
+      if (outage.closed || outage.outageEnd < 0.0)
+        {
+          continue;
+        }
+      double phaseEnd = outage.finished ? outage.phaseEnd : outage.start + m_maxDuration;
+      double end = GetEnd (outage, phaseEnd);
+      if (GetSlot (end + m_window) < m_lastSlot)
+        {
+          GetWindows (outage, end, outage.delay, outage.jitter);
+          outage.phaseEnd = phaseEnd;
+          outage.closed = true;
+        }
+    }
+  while (m_firstKept < m_outages.size () && m_outages[m_firstKept].closed)
+    {
+      m_firstKept++;
+    }
+
+  // the window before the handovers to come, and the windows of the open ones
+  int64_t first = GetSlot (receivedTime - m_window);
+  if (m_firstKept < m_outages.size ())
+    {
+      int64_t kept = GetSlot (m_outages[m_firstKept].start - m_window);
+      first = kept < first ? kept : first;
+    }
+  if (first <= m_firstSlot)
+    {
+      return;
+    }
+  if (first - m_firstSlot >= int64_t (m_slots.size ()))
+    {
+      m_slots.clear ();
+    }
+  else
+    {
+      m_slots.erase (m_slots.begin (), m_slots.begin () + (first - m_firstSlot));
+    }
+  m_firstSlot = first;
+}
+
+} // namespace ns3
@@ -0,0 +1,193 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Goran Shekerov <g_sekerov@yahoo.com>
+ */
+
+#ifndef TPA_HANDOVER_TIMELINE_H
+#define TPA_HANDOVER_TIMELINE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <iostream>
+#include "tpa-handover-detector.h"
+
+namespace ns3 {
+
+/**
+ * \brief Impact of one handover on the application traffic, times in [ms]
+ */
+struct TpaHandoverImpact
+{
+  enum Window
+  {
+    BEFORE = 0,
+    DURING = 1,
+    AFTER = 2
+  };
+
+  double   start;            //!< handover start: association request, or response when not seen
+  double   end;              //!< BA, or the last phase seen; at least the end of the outage
+  double   l3Delay;          //!< TpaHandover::GetL3Delay, -1 if not complete
+  double   outageStart;      //!< last packet received before the handover, -1 if none
+  double   outageEnd;        //!< first packet received after the start, -1 if none
+  uint32_t outageSent;       //!< packets sent after outageStart and before outageEnd
+  uint32_t outageDelivered;  //!< of those, the ones received (even after outageEnd)
+  double   delay[3];         //!< mean delay in the windows (Window), -1 without packets
+  double   jitter[3];        //!< mean jitter in the windows, -1 without samples
+
+  TpaHandoverImpact ();
+  /// \return outageEnd - outageStart, -1 if the outage is not bounded on both sides
+  double GetOutage (void) const;
+  /// \return the packets sent in the outage and never received
+  uint32_t GetLost (void) const;
+  /**
+   * Write the fields start [s], L3, outage, lost, delay before / during / after,
+   * jitter before / during / after, every field preceded by separator
+   */
+  void Print (std::ostream &os, const std::string &separator) const;
+};
+
+/**
+ * \brief Per-handover outage, loss, delay and jitter
+ *
+ * The outage of a handover is the gap in the received packets around its
+ * start: from the last packet received before Begin to the first one
+ * received after.  It is followed exactly as the packets are loaded, the
+ * packets sent in it are counted and the ones received later (AddDelay
+ * with their send time) are subtracted from them to give the loss.
+ * Handovers that start before the first packet is received (ping-pong)
+ * share the same outage.
+ *
+ * Delay and jitter are summed in time slots of the receive time (SlotWidth,
+ * 10 ms by default) so the windows before, during and after a handover
+ * can be taken once its end is known; the window edges are rounded to the
+ * slots.  The delays are expected in the order of their receive times (the
+ * order the packets are loaded in), the Begin and Finish calls can come
+ * before them or interleaved.  Only the slots still needed are kept: the
+ * last Window before the newest receive time, for the handovers to come,
+ * and from the window before the oldest handover whose window after is not
+ * over yet.  Once it is over (Finish called and the delays past it), the
+ * means of the handover are kept and its slots released, so the memory is
+ * O(handovers), not O(simulated time).  A handover lasts at most
+ * MaxDuration (10 s by default) from its start: one never finished (its
+ * BA lost) is taken to end then and closed like the others.
+ *
+ * Tpa feeds it with the handovers of its TpaHandoverDetector and appends
+ * the impact of every handover to its result line (attributes
+ * HandoverWindow, HandoverMaxDuration).
+ */
+class TpaHandoverTimeline
+{
+public:
+  TpaHandoverTimeline ();
+
+  /**
+   * \param width slot width [ms]; drops the delays already added
+   */
+  void SetSlotWidth (double width);
+  double GetSlotWidth (void) const;
+  /**
+   * \param window length of the windows before and after a handover [ms]
+   */
+  void SetWindow (double window);
+  double GetWindow (void) const;
+  /**
+   * \param duration longest handover [ms], from its start; a later end or
+   *        a handover not finished by then is cut to it
+   */
+  void SetMaxDuration (double duration);
+  double GetMaxDuration (void) const;
+
+  /// a handover started (TpaHandoverDetector), at timeNow [ms]
+  void Begin (double timeNow);
+  /**
+   * Handover i is finished, its phases won't change anymore; its windows are
+   * taken once the delays pass the end of its window after
+   */
+  void Finish (uint32_t i, const TpaHandover &handover);
+  /// an application packet was sent, at timeNow [ms]; only counted
+  void AddSent (double timeNow);
+  /// an application packet was received
+  void AddReceived (double timeNow);
+  /**
+   * \param sentTime send time of a received packet [ms]
+   * \param receivedTime its receive time [ms]
+   * \param delay its delay [ms]
+   * \param jitter its jitter [ms], < 0 if none
+   */
+  void AddDelay (double sentTime, double receivedTime, double delay, double jitter);
+
+  /// \return the number of Begin calls
+  uint32_t GetNHandovers (void) const;
+  /// \return the number of slots kept
+  uint32_t GetNSlots (void) const;
+  /**
+   * \param i number of the handover, in the order of Begin
+   * \param handover its phases, to find the end of the handover if it is
+   *        not finished (Finish)
+   */
+  TpaHandoverImpact GetImpact (uint32_t i, const TpaHandover &handover) const;
+  void Clear (void);
+
+private:
+  struct Outage
+  {
+    double   start;          // Begin time
+    double   outageStart;
+    double   outageEnd;
+    uint32_t sent;
+    uint32_t delivered;
+    double   phaseEnd;       // last phase, -1 until Finish or closed
+    bool     finished;
+    bool     closed;         // window after over, means taken
+    double   delay[3];       // TpaHandoverImpact::Window, once closed
+    double   jitter[3];
+  };
+  struct Slot
+  {
+    double   delaySum;
+    double   jitterSum;
+    uint32_t delays;
+    uint32_t jitters;
+  };
+
+  int64_t GetSlot (double time) const;
+  void GetMeans (int64_t first, int64_t last, double &delay, double &jitter) const;
+  /// the windows of the handover ending at end
+  void GetWindows (const Outage &outage, double end, double delay[3], double jitter[3]) const;
+  static double GetPhaseEnd (const TpaHandover &handover);
+  double GetEnd (const Outage &outage, double phaseEnd) const;
+  /// close the handovers whose window after is over, release the slots no longer needed
+  void Release (double receivedTime);
+
+  double   m_slotWidth;
+  double   m_window;
+  double   m_maxDuration;
+  double   m_lastReceived;     // -1 before the first packet
+  uint32_t m_sentSinceReceived;
+  uint32_t m_firstOpen;        // first outage still waiting for a packet
+  uint32_t m_firstKept;        // first handover not closed
+  int64_t  m_firstSlot;        // slot of m_slots[0]
+  int64_t  m_lastSlot;         // of the newest delay, -1 before the first
+  std::vector<Outage> m_outages;
+  std::deque<Slot>    m_slots;
+};
+
+} // namespace ns3
+
+#endif /* TPA_HANDOVER_TIMELINE_H */
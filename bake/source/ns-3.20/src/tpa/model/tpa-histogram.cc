@@ -0,0 +1,233 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Goran Shekerov <g_sekerov@yahoo.com>
+ */
+
+
+#include "tpa-histogram.h"
+#include <math.h>
+#include <sstream>
+#include <string>
+
+namespace ns3 {
+
+// 2^SUB_BUCKET_BITS buckets of one unit, then HALF_COUNT buckets per power of two
+static const uint32_t SUB_BUCKET_BITS = 7;
+static const uint32_t SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+static const uint32_t HALF_COUNT = SUB_BUCKET_COUNT / 2;
+
+TpaHistogram::TpaHistogram (double resolution)
+  : m_resolution (resolution)
+{
+  Reset ();
+}
+
+uint32_t
+TpaHistogram::GetIndex (uint64_t units)
+{
+  if (units < SUB_BUCKET_COUNT)
+    {
+      return units;
+    }
+  uint32_t msb = 63 - __builtin_clzll (units);
+  uint32_t shift = msb - SUB_BUCKET_BITS + 1;
+  return SUB_BUCKET_COUNT + (shift - 1) * HALF_COUNT + ((units >> shift) - HALF_COUNT);
+}
+
+uint64_t
+TpaHistogram::GetLowerBound (uint32_t index)
+{
+  if (index < SUB_BUCKET_COUNT)
+    {
+      return index;
+    }
+  uint32_t k = index - SUB_BUCKET_COUNT;
+  uint32_t shift = k / HALF_COUNT + 1;
+  uint64_t sub = k % HALF_COUNT + HALF_COUNT;
+  return sub << shift;
+}
+
+uint64_t
+TpaHistogram::GetUpperBound (uint32_t index)
+{
+  if (index < SUB_BUCKET_COUNT)
+    {
+      return index;
+    }
+  uint32_t k = index - SUB_BUCKET_COUNT;
+  uint32_t shift = k / HALF_COUNT + 1;
+  uint64_t sub = k % HALF_COUNT + HALF_COUNT;
+  return ((sub + 1) << shift) - 1;
+}
+
+void
+TpaHistogram::Add (double value)
+{
+  if (m_count == 0 || value < m_min) {m_min = value;}
+  if (m_count == 0 || value > m_max) {m_max = value;}
+  m_count = m_count + 1;
+
+  uint64_t units = value > 0 ? uint64_t (value / m_resolution + 0.5) : 0;
+  uint32_t index = GetIndex (units);
+  if (index >= m_counts.size ())
+    {
+      m_counts.resize (index + 1, 0);
+    }
+  m_counts[index] = m_counts[index] + 1;
+}
+
+bool
+TpaHistogram::Merge (const TpaHistogram &other)
+{
+  if (other.m_resolution != m_resolution)
+    {
+      return false;
+    }
+  if (other.m_count == 0)
+    {
+      return true;
+    }
+  if (m_count == 0 || other.m_min < m_min) {m_min = other.m_min;}
+  if (m_count == 0 || other.m_max > m_max) {m_max = other.m_max;}
+  m_count = m_count + other.m_count;
+  if (other.m_counts.size () > m_counts.size ())
+    {
+      m_counts.resize (other.m_counts.size (), 0);
+    }
+  for (uint32_t i = 0; i < other.m_counts.size (); i++)
+    {
+      m_counts[i] = m_counts[i] + other.m_counts[i];
+    }
+  return true;
+}
+
+void
+TpaHistogram::Reset (void)
+{
+  m_counts.clear ();
+  m_count = 0;
+  m_min = 0.0;
+  m_max = 0.0;
+}
+
+uint64_t
+TpaHistogram::GetCount (void) const
+{
+  return m_count;
+}
+
+double
+TpaHistogram::GetResolution (void) const
+{
+  return m_resolution;
+}
+
+double
+TpaHistogram::GetMin (void) const
+{
+  return m_min;
+}
+
+double
+TpaHistogram::GetMax (void) const
+{
+  return m_max;
+}
+
+double
+TpaHistogram::GetQuantile (double q) const
+{
+  if (m_count == 0)
+    {
+      return 0.0;
+    }
+  if (q <= 0.0) {return m_min;}
+  if (q >= 1.0) {return m_max;}
+
+  uint64_t rank = uint64_t (ceil (q * m_count));
+  if (rank == 0) {rank = 1;}
+  uint64_t seen = 0;
+  for (uint32_t i = 0; i < m_counts.size (); i++)
+    {
+      seen = seen + m_counts[i];
+      if (seen >= rank)
+        {
+          // middle of the bucket, kept inside the exact min/max
+          double value = (GetLowerBound (i) + GetUpperBound (i)) / 2.0 * m_resolution;
+          if (value < m_min) {value = m_min;}
+          if (value > m_max) {value = m_max;}
+          return value;
+        }
+    }
+  return m_max;
+}
+
+void
+TpaHistogram::Print (std::ostream &os) const
+{
+  std::ostringstream line; // keep the caller's stream flags untouched
+  line.precision (17);
+  line << m_resolution << " " << m_count << " " << m_min << " " << m_max;
+  for (uint32_t i = 0; i < m_counts.size (); i++)
+    {
+      if (m_counts[i] != 0)
+        {
+          line << " " << i << ":" << m_counts[i];
+        }
+    }
+  os << line.str ();
+}
+
+bool
+TpaHistogram::Read (std::istream &is)
+{
+  std::string text;
+  if (!std::getline (is, text))
+    {
+      return false;
+    }
+  std::istringstream line (text);
+  TpaHistogram h;
+  if (!(line >> h.m_resolution >> h.m_count >> h.m_min >> h.m_max))
+    {
+      return false;
+    }
+  uint32_t index;
+  char colon;
+  uint64_t n;
+  uint64_t total = 0;
+  while (line >> index >> colon >> n)
+    {
+      if (colon != ':' || index > GetIndex (~uint64_t (0)))
+        {
+          return false;
+        }
+      if (index >= h.m_counts.size ())
+        {
+          h.m_counts.resize (index + 1, 0);
+        }
+      h.m_counts[index] = h.m_counts[index] + n;
+      total = total + n;
+    }
+  if (total != h.m_count)
+    {
+      return false;
+    }
+  *this = h;
+  return true;
+}
+
+} // namespace ns3
@@ -0,0 +1,95 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Goran Shekerov <g_sekerov@yahoo.com>
+ */
+
+
+#ifndef TPA_HISTOGRAM_H
+#define TPA_HISTOGRAM_H
+
+#include <stdint.h>
+#include <vector>
+#include <iostream>
+
+namespace ns3 {
+
+/**
+ * \brief Mergeable log-linear histogram for delay and jitter quantiles
+ *
+ * HDR-histogram style: the values are counted in units of "resolution";
+ * up to 128 units every unit has its own bucket, above that every power
+ * of two is split in 64 linear sub-buckets.  A quantile is therefore known
+ * within 1/64 (~1.6%) of its value, whatever the range, and the buckets
+ * cover all of 64-bit unit values in less than 4000 counters, allocated
+ * only up to the biggest value seen.
+ *
+ * Two histograms with the same resolution can be merged by adding the
+ * counters, and a histogram can be written and read back as one text line,
+ * so replications can be pooled without the raw samples.
+ */
+class TpaHistogram
+{
+public:
+  /**
+   * \param resolution the smallest distinguishable value (e.g. 0.001 ms)
+   */
+  TpaHistogram (double resolution = 0.001);
+
+  void Add (double value);
+  /**
+   * \return false if the resolutions differ, nothing is merged then
+   */
+  bool Merge (const TpaHistogram &other);
+  void Reset (void);
+
+  uint64_t GetCount (void) const;
+  double GetResolution (void) const;
+  /// exact smallest value added
+  double GetMin (void) const;
+  /// exact biggest value added
+  double GetMax (void) const;
+  /**
+   * \param q the quantile, 0.0 to 1.0 (e.g. 0.99 for p99)
+   * \return the value under which a fraction q of the samples lies, 0 when empty
+   */
+  double GetQuantile (double q) const;
+
+  /**
+   * Write "resolution count min max idx:n idx:n ..." on one line,
+   * only the non empty buckets
+   */
+  void Print (std::ostream &os) const;
+  /**
+   * Read back a line written with Print; the old content is dropped
+   * \return false if the line could not be parsed
+   */
+  bool Read (std::istream &is);
+
+private:
+  static uint32_t GetIndex (uint64_t units);
+  static uint64_t GetLowerBound (uint32_t index);
+  static uint64_t GetUpperBound (uint32_t index);
+
+  double m_resolution;
+  std::vector<uint64_t> m_counts;
+  uint64_t m_count;
+  double m_min;
+  double m_max;
+};
+
+} // namespace ns3
+
+#endif /* TPA_HISTOGRAM_H */
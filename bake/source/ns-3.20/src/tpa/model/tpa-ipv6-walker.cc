@@ -0,0 +1,233 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Goran Shekerov <g_sekerov@yahoo.com>
+ */
+
+
+#include "tpa-ipv6-walker.h"
+
+namespace ns3 {
+
+namespace {
+
+enum HeaderKind
+{
+  UPPER_LAYER = 0,   // stop, anything not in the table
+  IPV6,              // encapsulated IPv6, 40 bytes
+  EXTENSION,         // generic extension: (length + 1) * 8 bytes
+  FRAGMENT,          // 8 bytes
+  MOBILITY           // Mobility header, last header of the chain
+};
+
+struct HeaderInfo
+{
+  uint8_t nextHeader;
+  uint8_t kind;
+  uint8_t flag;
+};
+
+const HeaderInfo g_headers[] = {
+  {   0, EXTENSION, TPA_PATH_HOP_BY_HOP },
+  {  41, IPV6,      TPA_PATH_TUNNEL },
+  {  43, EXTENSION, 0 },                 // RO flag set when routing type is 2
+  {  44, FRAGMENT,  TPA_PATH_FRAGMENT },
+  {  60, EXTENSION, 0 },                 // RO flag set when it holds a Home Address option
+  { 135, MOBILITY,  TPA_PATH_MOBILITY }
+};
+
+const uint32_t IPV6_HEADER_SIZE = 40;
+const uint32_t MAX_HEADERS = 16;
+const uint8_t  ROUTING_HEADER = 43;
+const uint8_t  DESTINATION_OPTIONS = 60;
+const uint8_t  ROUTING_TYPE_2 = 2;
+const uint8_t  HOME_ADDRESS_OPTION = 201;
+const uint8_t  PAD1_OPTION = 0;
+
+struct HeaderTable
+{
+  uint8_t kind[256];
+  uint8_t flag[256];
+  HeaderTable ()
+  {
+    for (uint32_t i = 0; i < 256; i++)
+      {
+        kind[i] = UPPER_LAYER;
+        flag[i] = 0;
+      }
+    for (uint32_t i = 0; i < sizeof (g_headers) / sizeof (g_headers[0]); i++)
+      {
+        kind[g_headers[i].nextHeader] = g_headers[i].kind;
+        flag[g_headers[i].nextHeader] = g_headers[i].flag;
+      }
+  }
+};
+
+const HeaderTable g_table;
+
+// scan the options of a Destination Options header for the Home Address option,
+// returns the offset of the option or 0
+uint32_t
+FindHomeAddressOption (const TpaPacketView &view, uint32_t offset, uint32_t length)
+{
+  uint32_t i = offset + 2;
+  uint32_t end = offset + length;
+  while (i < end)
+    {
+      uint8_t type = view.ReadU8 (i);
+      if (type == HOME_ADDRESS_OPTION)
+        {
+          return i;
+        }
+      if (type == PAD1_OPTION)
+        {
+          i = i + 1;
+          continue;
+        }
+      if (i + 1 >= end)
+        {
+          break;
+        }
+      i = i + 2 + view.ReadU8 (i + 1);
+    }
+  return 0;
+}
+
+} // anonymous namespace
+
+bool
+TpaIpv6Walker::Walk (const TpaPacketView &view, uint32_t offset, TpaIpv6Path &path)
+{
+  path.flags = 0;
+  path.protocol = 59;
+  path.offset = offset;
+  path.ipv6Offset = offset;
+  path.rh2Offset = 0;
+  path.haoOffset = 0;
+
+  if (!view.Has (offset, IPV6_HEADER_SIZE) || (view.ReadU8 (offset) >> 4) != 6)
+    {
+      return false;
+    }
+  uint8_t nextHeader = view.ReadU8 (offset + 6);
+  offset = offset + IPV6_HEADER_SIZE;
+
+  for (uint32_t depth = 0; depth < MAX_HEADERS; depth++)
+    {
+      uint8_t kind = g_table.kind[nextHeader];
+      path.flags = path.flags | g_table.flag[nextHeader];
+
+      if (kind == UPPER_LAYER || kind == MOBILITY)
+        {
+          path.protocol = nextHeader;
+          path.offset = offset;
+          return true;
+        }
+
+      uint32_t length;
+      if (kind == IPV6)
+        {
+          if (!view.Has (offset, IPV6_HEADER_SIZE) || (view.ReadU8 (offset) >> 4) != 6)
+            {
+              return false;
+            }
+          path.ipv6Offset = offset;
+          length = IPV6_HEADER_SIZE;
+          nextHeader = view.ReadU8 (offset + 6);
+        }
+      else
+        {
+          if (!view.Has (offset, 8))
+            {
+              return false;
+            }
+          length = kind == FRAGMENT ? 8 : (view.ReadU8 (offset + 1) + 1) * 8;
+          if (!view.Has (offset, length))
+            {
+              return false;
+            }
+          // only the first fragment (offset 0) holds the upper layer header
+          if (kind == FRAGMENT && (view.ReadNtohU16 (offset + 2) >> 3) != 0)
+            {
+              path.offset = offset + length;
+              return true;
+            }
+          if (nextHeader == ROUTING_HEADER && view.ReadU8 (offset + 2) == ROUTING_TYPE_2
+              && length >= 24)
+            {
+              path.flags = path.flags | TPA_PATH_RO_RH2;
+              path.rh2Offset = offset + 8;
+            }
+          if (nextHeader == DESTINATION_OPTIONS)
+            {
+              uint32_t option = FindHomeAddressOption (view, offset, length);
+              if (option != 0 && option + 18 <= offset + length)
+                {
+                  path.flags = path.flags | TPA_PATH_RO_HAO;
+                  path.haoOffset = option + 2;
+                }
+            }
+          nextHeader = view.ReadU8 (offset);
+        }
+      offset = offset + length;
+    }
+  return false;
+}
+
+bool
+TpaIpv6Walker::FindIpv6Header (const TpaPacketView &view, uint32_t &offset)
+{
+  // LLC/SNAP: AA AA 03, OUI 00 00 00, type 86 DD
+  if (view.Has (0, 9) && view.ReadU8 (0) == 0xaa && view.ReadU8 (1) == 0xaa && view.ReadU8 (2) == 0x03
+      && view.ReadNtohU16 (6) == 0x86dd && (view.ReadU8 (8) >> 4) == 6)
+    {
+      offset = 8;
+      return true;
+    }
+  // Ethernet II: destination, source, type 86 DD
+  if (view.Has (0, 15) && view.ReadNtohU16 (12) == 0x86dd && (view.ReadU8 (14) >> 4) == 6)
+    {
+      offset = 14;
+      return true;
+    }
+  if (view.Has (0, 1) && (view.ReadU8 (0) >> 4) == 6)
+    {
+      offset = 0;
+      return true;
+    }
+  return false;
+}
+
+const char *
+TpaIpv6Walker::GetPathName (uint8_t flags)
+{
+  if (IsRouteOptimized (flags))
+    {
+      return "ro";
+    }
+  if (flags & TPA_PATH_TUNNEL)
+    {
+      return "tunnel";
+    }
+  return "direct";
+}
+
+bool
+TpaIpv6Walker::IsRouteOptimized (uint8_t flags)
+{
+  return (flags & (TPA_PATH_RO_RH2 | TPA_PATH_RO_HAO)) != 0;
+}
+
+} // namespace ns3
@@ -0,0 +1,95 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Goran Shekerov <g_sekerov@yahoo.com>
+ */
+
+
+#ifndef TPA_IPV6_WALKER_H
+#define TPA_IPV6_WALKER_H
+
+#include <stdint.h>
+#include "tpa-packet-view.h"
+
+namespace ns3 {
+
+/**
+ * \brief Path taken by a MIPv6 packet, as seen in its IPv6 header chain
+ */
+enum TpaPathFlag
+{
+  TPA_PATH_TUNNEL     = 0x01, //!< IPv6 in IPv6, HA - MN bidirectional tunnel
+  TPA_PATH_RO_RH2     = 0x02, //!< Type 2 Routing header, CN -> MN route optimization
+  TPA_PATH_RO_HAO     = 0x04, //!< Home Address destination option, MN -> CN route optimization
+  TPA_PATH_MOBILITY   = 0x08, //!< Mobility header (BU, BA, HoTI, ...)
+  TPA_PATH_HOP_BY_HOP = 0x10,
+  TPA_PATH_FRAGMENT   = 0x20
+};
+
+/**
+ * \brief Result of walking an IPv6 header chain
+ */
+struct TpaIpv6Path
+{
+  uint32_t offset;     //!< offset of the upper layer header (UDP, ICMPv6, Mobility header)
+  uint32_t ipv6Offset; //!< offset of the inner-most IPv6 header
+  uint32_t rh2Offset;  //!< offset of the home address in the Type 2 Routing header, 0 if none
+  uint32_t haoOffset;  //!< offset of the home address in the Home Address option, 0 if none
+  uint8_t  protocol;   //!< upper layer protocol number, 59 if there is none
+  uint8_t  flags;      //!< TpaPathFlag bits
+};
+
+/**
+ * \brief Table-driven walker over IPv6 extension headers and encapsulated IPv6
+ *
+ * Starting at an IPv6 header in a TpaPacketView, follows the next header
+ * chain through Hop-by-Hop, Routing, Fragment, Destination Options and
+ * encapsulated IPv6 headers until an upper layer protocol (or the Mobility
+ * header) is reached, without copying anything.  On the way it records
+ * the path of the packet: tunnelled by the HA, route optimized (Type 2
+ * Routing header or Home Address option) or direct.
+ */
+class TpaIpv6Walker
+{
+public:
+  /**
+   * \param view the packet bytes
+   * \param offset offset of the first (outer) IPv6 header
+   * \param path filled with the upper layer protocol, offsets and path flags;
+   *        protocol 59 (none) for a fragment other than the first one
+   * \return false if the chain is not IPv6, is truncated in the view or too long
+   */
+  static bool Walk (const TpaPacketView &view, uint32_t offset, TpaIpv6Path &path);
+  /**
+   * Find the first IPv6 header whatever the link layer the packet was traced on:
+   * none (WifiMac MacRx), LLC/SNAP (WifiMac MacTx) or Ethernet (CSMA MacTx/MacRx)
+   * \param view the packet bytes
+   * \param offset set to the offset of the IPv6 header
+   * \return false if no IPv6 header was recognized
+   */
+  static bool FindIpv6Header (const TpaPacketView &view, uint32_t &offset);
+  /**
+   * \return "ro", "tunnel" or "direct" for a set of path flags
+   */
+  static const char * GetPathName (uint8_t flags);
+  /**
+   * \return true if the path flags say the packet was route optimized
+   */
+  static bool IsRouteOptimized (uint8_t flags);
+};
+
+} // namespace ns3
+
+#endif /* TPA_IPV6_WALKER_H */
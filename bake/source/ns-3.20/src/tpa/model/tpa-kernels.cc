@@ -0,0 +1,358 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Goran Shekerov <g_sekerov@yahoo.com>
+ */
+
+#include "tpa-kernels.h"
+
+#if (defined (__x86_64__) || defined (__i386__)) && \
+  (defined (__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define TPA_KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+namespace ns3 {
+
+namespace {
+
+struct TpaKernelTable
+{
+  TpaKernels::Isa isa;
+  uint64_t (*sumU32) (const uint32_t *values, std::size_t n);
+  int64_t (*sumI64) (const int64_t *values, std::size_t n);
+  void (*subtract) (const int64_t *a, const int64_t *b, int64_t *out, std::size_t n);
+  void (*absDiff) (const int64_t *a, const int64_t *b, int64_t *out, std::size_t n);
+  void (*minMax) (const int64_t *values, std::size_t n, int64_t &min, int64_t &max);
+};
+
+uint64_t
+SumU32Scalar (const uint32_t *values, std::size_t n)
+{
+  uint64_t sum = 0;
+  for (std::size_t i = 0; i < n; i++)
+    {
+      sum = sum + values[i];
+    }
+  return sum;
+}
+
+int64_t
+SumI64Scalar (const int64_t *values, std::size_t n)
+{
+  int64_t sum = 0;
+  for (std::size_t i = 0; i < n; i++)
+    {
+      sum = sum + values[i];
+    }
+  return sum;
+}
+
+void
+SubtractScalar (const int64_t *a, const int64_t *b, int64_t *out, std::size_t n)
+{
+  for (std::size_t i = 0; i < n; i++)
+    {
+      out[i] = a[i] - b[i];
+    }
+}
+
+void
+AbsDiffScalar (const int64_t *a, const int64_t *b, int64_t *out, std::size_t n)
+{
+  for (std::size_t i = 0; i < n; i++)
+    {
+      out[i] = a[i] > b[i] ? a[i] - b[i] : b[i] - a[i];
+    }
+}
+
+void
+MinMaxScalar (const int64_t *values, std::size_t n, int64_t &min, int64_t &max)
+{
+  for (std::size_t i = 0; i < n; i++)
+    {
+      if (values[i] < min) {min = values[i];}
+      if (values[i] > max) {max = values[i];}
+    }
+}
+
+#ifdef TPA_KERNELS_X86
+
+// The 32 bit values are zero extended to 64 bit lanes before they are
+// added: exact sums whatever the number of values
+__attribute__ ((target ("sse4.2"))) uint64_t
+SumU32Sse (const uint32_t *values, std::size_t n)
+{
+  const __m128i zero = _mm_setzero_si128 ();
+  __m128i sum = zero;
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+    {
+      __m128i v = _mm_loadu_si128 (reinterpret_cast<const __m128i *> (values + i));
+      sum = _mm_add_epi64 (sum, _mm_unpacklo_epi32 (v, zero));
+      sum = _mm_add_epi64 (sum, _mm_unpackhi_epi32 (v, zero));
+    }
+  uint64_t lanes[2];
+  _mm_storeu_si128 (reinterpret_cast<__m128i *> (lanes), sum);
+  return lanes[0] + lanes[1] + SumU32Scalar (values + i, n - i);
+}
+
+__attribute__ ((target ("sse4.2"))) int64_t
+SumI64Sse (const int64_t *values, std::size_t n)
+{
+  __m128i sum = _mm_setzero_si128 ();
+  std::size_t i = 0;
+  for (; i + 2 <= n; i += 2)
+    {
+      sum = _mm_add_epi64 (sum, _mm_loadu_si128 (reinterpret_cast<const __m128i *> (values + i)));
+    }
+  int64_t lanes[2];
+  _mm_storeu_si128 (reinterpret_cast<__m128i *> (lanes), sum);
+  return lanes[0] + lanes[1] + SumI64Scalar (values + i, n - i);
+}
+
+__attribute__ ((target ("sse4.2"))) void
+SubtractSse (const int64_t *a, const int64_t *b, int64_t *out, std::size_t n)
+{
+  std::size_t i = 0;
+  for (; i + 2 <= n; i += 2)
+    {
+      __m128i va = _mm_loadu_si128 (reinterpret_cast<const __m128i *> (a + i));
+      __m128i vb = _mm_loadu_si128 (reinterpret_cast<const __m128i *> (b + i));
+      _mm_storeu_si128 (reinterpret_cast<__m128i *> (out + i), _mm_sub_epi64 (va, vb));
+    }
+  SubtractScalar (a + i, b + i, out + i, n - i);
+}
+
+// |d| = (d ^ sign) - sign, the sign mask from a 64 bit compare with zero
+__attribute__ ((target ("sse4.2"))) void
+AbsDiffSse (const int64_t *a, const int64_t *b, int64_t *out, std::size_t n)
+{
+  const __m128i zero = _mm_setzero_si128 ();
+  std::size_t i = 0;
+  for (; i + 2 <= n; i += 2)
+    {
+      __m128i va = _mm_loadu_si128 (reinterpret_cast<const __m128i *> (a + i));
+      __m128i vb = _mm_loadu_si128 (reinterpret_cast<const __m128i *> (b + i));
+      __m128i d = _mm_sub_epi64 (va, vb);
+      __m128i sign = _mm_cmpgt_epi64 (zero, d);
+      _mm_storeu_si128 (reinterpret_cast<__m128i *> (out + i), _mm_sub_epi64 (_mm_xor_si128 (d, sign), sign));
+    }
+  AbsDiffScalar (a + i, b + i, out + i, n - i);
+}
+
+__attribute__ ((target ("sse4.2"))) void
+MinMaxSse (const int64_t *values, std::size_t n, int64_t &min, int64_t &max)
+{
+  __m128i vmin = _mm_set1_epi64x (min);
+  __m128i vmax = _mm_set1_epi64x (max);
+  std::size_t i = 0;
+  for (; i + 2 <= n; i += 2)
+    {
+      __m128i v = _mm_loadu_si128 (reinterpret_cast<const __m128i *> (values + i));
+      vmin = _mm_blendv_epi8 (vmin, v, _mm_cmpgt_epi64 (vmin, v));
+      vmax = _mm_blendv_epi8 (vmax, v, _mm_cmpgt_epi64 (v, vmax));
+    }
+  int64_t lanes[2];
+  _mm_storeu_si128 (reinterpret_cast<__m128i *> (lanes), vmin);
+  MinMaxScalar (lanes, 2, min, max);
+  _mm_storeu_si128 (reinterpret_cast<__m128i *> (lanes), vmax);
+  MinMaxScalar (lanes, 2, min, max);
+  MinMaxScalar (values + i, n - i, min, max);
+}
+
+__attribute__ ((target ("avx2"))) uint64_t
+SumU32Avx2 (const uint32_t *values, std::size_t n)
+{
+  __m256i sum0 = _mm256_setzero_si256 ();
+  __m256i sum1 = _mm256_setzero_si256 ();
+  std::size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+    {
+      sum0 = _mm256_add_epi64 (sum0, _mm256_cvtepu32_epi64 (_mm_loadu_si128 (reinterpret_cast<const __m128i *> (values + i))));
+      sum1 = _mm256_add_epi64 (sum1, _mm256_cvtepu32_epi64 (_mm_loadu_si128 (reinterpret_cast<const __m128i *> (values + i + 4))));
+    }
+  uint64_t lanes[4];
+  _mm256_storeu_si256 (reinterpret_cast<__m256i *> (lanes), _mm256_add_epi64 (sum0, sum1));
+  return lanes[0] + lanes[1] + lanes[2] + lanes[3] + SumU32Scalar (values + i, n - i);
+}
+
+__attribute__ ((target ("avx2"))) int64_t
+SumI64Avx2 (const int64_t *values, std::size_t n)
+{
+  // two accumulators, the adds of consecutive iterations don't wait on each other
+  __m256i sum0 = _mm256_setzero_si256 ();
+  __m256i sum1 = _mm256_setzero_si256 ();
+  std::size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+    {
+      sum0 = _mm256_add_epi64 (sum0, _mm256_loadu_si256 (reinterpret_cast<const __m256i *> (values + i)));
+      sum1 = _mm256_add_epi64 (sum1, _mm256_loadu_si256 (reinterpret_cast<const __m256i *> (values + i + 4)));
+    }
+  int64_t lanes[4];
+  _mm256_storeu_si256 (reinterpret_cast<__m256i *> (lanes), _mm256_add_epi64 (sum0, sum1));
+  return lanes[0] + lanes[1] + lanes[2] + lanes[3] + SumI64Scalar (values + i, n - i);
+}
+
+__attribute__ ((target ("avx2"))) void
+SubtractAvx2 (const int64_t *a, const int64_t *b, int64_t *out, std::size_t n)
+{
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+    {
+      __m256i va = _mm256_loadu_si256 (reinterpret_cast<const __m256i *> (a + i));
+      __m256i vb = _mm256_loadu_si256 (reinterpret_cast<const __m256i *> (b + i));
+      _mm256_storeu_si256 (reinterpret_cast<__m256i *> (out + i), _mm256_sub_epi64 (va, vb));
+    }
+  SubtractScalar (a + i, b + i, out + i, n - i);
+}
+
+__attribute__ ((target ("avx2"))) void
+AbsDiffAvx2 (const int64_t *a, const int64_t *b, int64_t *out, std::size_t n)
+{
+  const __m256i zero = _mm256_setzero_si256 ();
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+    {
+      __m256i va = _mm256_loadu_si256 (reinterpret_cast<const __m256i *> (a + i));
+      __m256i vb = _mm256_loadu_si256 (reinterpret_cast<const __m256i *> (b + i));
+      __m256i d = _mm256_sub_epi64 (va, vb);
+      __m256i sign = _mm256_cmpgt_epi64 (zero, d);
+      _mm256_storeu_si256 (reinterpret_cast<__m256i *> (out + i), _mm256_sub_epi64 (_mm256_xor_si256 (d, sign), sign));
+    }
+  AbsDiffScalar (a + i, b + i, out + i, n - i);
+}
+
+__attribute__ ((target ("avx2"))) void
+MinMaxAvx2 (const int64_t *values, std::size_t n, int64_t &min, int64_t &max)
+{
+  __m256i vmin = _mm256_set1_epi64x (min);
+  __m256i vmax = _mm256_set1_epi64x (max);
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+    {
+      __m256i v = _mm256_loadu_si256 (reinterpret_cast<const __m256i *> (values + i));
+      vmin = _mm256_blendv_epi8 (vmin, v, _mm256_cmpgt_epi64 (vmin, v));
+      vmax = _mm256_blendv_epi8 (vmax, v, _mm256_cmpgt_epi64 (v, vmax));
+    }
+  int64_t lanes[4];
+  _mm256_storeu_si256 (reinterpret_cast<__m256i *> (lanes), vmin);
+  MinMaxScalar (lanes, 4, min, max);
+  _mm256_storeu_si256 (reinterpret_cast<__m256i *> (lanes), vmax);
+  MinMaxScalar (lanes, 4, min, max);
+  MinMaxScalar (values + i, n - i, min, max);
+}
+
+#endif /* TPA_KERNELS_X86 */
+
+const TpaKernelTable g_kernelTables[3] = {
+  { TpaKernels::SCALAR, SumU32Scalar, SumI64Scalar, SubtractScalar, AbsDiffScalar, MinMaxScalar },
+#ifdef TPA_KERNELS_X86
+  { TpaKernels::SSE42, SumU32Sse, SumI64Sse, SubtractSse, AbsDiffSse, MinMaxSse },
+  { TpaKernels::AVX2, SumU32Avx2, SumI64Avx2, SubtractAvx2, AbsDiffAvx2, MinMaxAvx2 }
+#else
+  { TpaKernels::SCALAR, SumU32Scalar, SumI64Scalar, SubtractScalar, AbsDiffScalar, MinMaxScalar },
+  { TpaKernels::SCALAR, SumU32Scalar, SumI64Scalar, SubtractScalar, AbsDiffScalar, MinMaxScalar }
+#endif
+};
+
+const TpaKernelTable *g_kernels = 0; // in use, chosen at the first call
+
+inline const TpaKernelTable &
+GetKernels (void)
+{
+  if (g_kernels == 0)
+    {
+      g_kernels = &g_kernelTables[TpaKernels::GetBestIsa ()];
+    }
+  return *g_kernels;
+}
+
+} // anonymous namespace
+
+TpaKernels::Isa
+TpaKernels::GetIsa (void)
+{
+  return GetKernels ().isa;
+}
+
+TpaKernels::Isa
+TpaKernels::GetBestIsa (void)
+{
+#ifdef TPA_KERNELS_X86
+  __builtin_cpu_init ();
+  if (__builtin_cpu_supports ("avx2"))
+    {
+      return AVX2;
+    }
+  if (__builtin_cpu_supports ("sse4.2"))
+    {
+      return SSE42;
+    }
+#endif
+  return SCALAR;
+}
+
+TpaKernels::Isa
+TpaKernels::SetIsa (Isa isa)
+{
+  Isa best = GetBestIsa ();
+  g_kernels = &g_kernelTables[isa < best ? isa : best];
+  return g_kernels->isa;
+}
+
+const char *
+TpaKernels::GetIsaName (Isa isa)
+{
+  switch (isa)
+    {
+    case SCALAR: return "scalar";
+    case SSE42:  return "sse4.2";
+    case AVX2:   return "avx2";
+    }
+  return "unknown";
+}
+
+uint64_t
+TpaKernels::SumU32 (const uint32_t *values, std::size_t n)
+{
+  return GetKernels ().sumU32 (values, n);
+}
+
+int64_t
+TpaKernels::SumI64 (const int64_t *values, std::size_t n)
+{
+  return GetKernels ().sumI64 (values, n);
+}
+
+void
+TpaKernels::Subtract (const int64_t *a, const int64_t *b, int64_t *out, std::size_t n)
+{
+  GetKernels ().subtract (a, b, out, n);
+}
+
+void
+TpaKernels::AbsDiff (const int64_t *a, const int64_t *b, int64_t *out, std::size_t n)
+{
+  GetKernels ().absDiff (a, b, out, n);
+}
+
+void
+TpaKernels::MinMax (const int64_t *values, std::size_t n, int64_t &min, int64_t &max)
+{
+  GetKernels ().minMax (values, n, min, max);
+}
+
+} // namespace ns3
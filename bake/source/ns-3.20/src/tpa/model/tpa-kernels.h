@@ -0,0 +1,72 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Goran Shekerov <g_sekerov@yahoo.com>
+ */
+
+#ifndef TPA_KERNELS_H
+#define TPA_KERNELS_H
+
+#include <stdint.h>
+#include <cstddef>
+
+namespace ns3 {
+
+/**
+ * \brief Kernels over the columns of the buffered Tpa packet records
+ *
+ * Every kernel has a scalar version and, on x86 with GCC 4.9 or clang,
+ * SSE4.2 and AVX2 versions compiled with the target attribute, so the
+ * module is built without any -m flag.  The best version the CPU supports
+ * is chosen at the first call; SetIsa forces one (tests, benchmarks).
+ * The results are the same with every version, the sums are exact.
+ */
+class TpaKernels
+{
+public:
+  enum Isa
+  {
+    SCALAR = 0,
+    SSE42,
+    AVX2
+  };
+
+  /// \return the instruction set of the kernels in use
+  static Isa GetIsa (void);
+  /// \return the best instruction set supported by the CPU and the build
+  static Isa GetBestIsa (void);
+  /**
+   * Use the kernels of isa, or of the best instruction set supported if it
+   * is not
+   * \return the instruction set now in use
+   */
+  static Isa SetIsa (Isa isa);
+  static const char * GetIsaName (Isa isa);
+
+  /// \return the sum of the n values (packet sizes)
+  static uint64_t SumU32 (const uint32_t *values, std::size_t n);
+  /// \return the sum of the n values (delays, jitter samples)
+  static int64_t SumI64 (const int64_t *values, std::size_t n);
+  /// out[i] = a[i] - b[i] (delays from the received and sent times); out may be a or b
+  static void Subtract (const int64_t *a, const int64_t *b, int64_t *out, std::size_t n);
+  /// out[i] = |a[i] - b[i]| (jitter from the delays and the previous ones); out may be a or b
+  static void AbsDiff (const int64_t *a, const int64_t *b, int64_t *out, std::size_t n);
+  /// Extend [min, max] to the n values
+  static void MinMax (const int64_t *values, std::size_t n, int64_t &min, int64_t &max);
+};
+
+} // namespace ns3
+
+#endif /* TPA_KERNELS_H */
@@ -0,0 +1,324 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Goran Shekerov <g_sekerov@yahoo.com>
+ */
+
+#include "tpa-loss-runs.h"
+
+namespace ns3 {
+
+TpaGilbertElliott::TpaGilbertElliott ()
+  : p (0.0),
+    r (0.0),
+    burstDensity (0.0),
+    gapDensity (0.0),
+    bursts (0),
+    burstPackets (0),
+    gapPackets (0)
+{
+}
+
+const uint32_t TpaLossRuns::BINS;
+
+TpaLossRuns::TpaLossRuns ()
+  : m_gmin (16)
+{
+  Clear ();
+}
+
+void
+TpaLossRuns::SetGmin (uint32_t gmin)
+{
+  m_gmin = gmin;
+}
+
+uint32_t
+TpaLossRuns::GetGmin (void) const
+{
+  return m_gmin;
+}
+
+uint32_t
+TpaLossRuns::GetBin (uint32_t length)
+{
+  uint32_t bin = 0;
+  while (length > 1)
+    {
+      length = length >> 1;
+      bin = bin + 1;
+    }
+  return bin;
+}
+
+uint32_t
+TpaLossRuns::AddSeq (uint32_t seq)
+{
+  uint32_t lost = 0;
+  if (m_started)
+    {
+      if (int32_t (seq - m_nextExpected) < 0)
+        {
+          return 0;                   // late or duplicated
+        }
+      lost = seq - m_nextExpected;
+      AddLost (lost);
+    }
+  m_started = true;
+  m_nextExpected = seq + 1;
+  AddReceived ();
+  return lost;
+}
+
+void
+TpaLossRuns::AddLost (uint32_t count)
+{
+  if (count == 0)
+    {
+      return;
+    }
+  m_lost = m_lost + count;
+
+  if (!m_runLost)
+    {
+      if (m_runLength > 0)
+        {
+          m_gapRuns[GetBin (m_runLength)]++;
+        }
+      m_runLost = true;
+      m_runLength = 0;
+    }
+  m_runLength = m_runLength + count;
+  m_maxLossRun = m_runLength > m_maxLossRun ? m_runLength : m_maxLossRun;
+
+  if (m_burstLosses == 0 || m_sinceLoss >= m_gmin)
+    {
+      CloseBurst ();
+      m_model.gapPackets = m_model.gapPackets + m_sinceLoss;
+      m_burstPackets = count;
+      m_burstLosses = count;
+    }
+  else
+    {
+      m_burstPackets = m_burstPackets + m_sinceLoss + count;
+      m_burstLosses = m_burstLosses + count;
+    }
+  m_sinceLoss = 0;
+}
+
+void
+TpaLossRuns::AddReceived (void)
+{
+  m_received = m_received + 1;
+  if (m_runLost)
+    {
+      m_lossRuns[GetBin (m_runLength)]++;
+      m_nLossRuns = m_nLossRuns + 1;
+      m_runLost = false;
+      m_runLength = 0;
+    }
+  m_runLength = m_runLength + 1;
+  m_sinceLoss = m_sinceLoss + 1;
+}
+
+void
+TpaLossRuns::CloseBurst (void)
+{
+  if (m_burstLosses == 1)
+    {
+      // a lone loss is part of the gap
+      m_model.gapPackets = m_model.gapPackets + 1;
+      m_gapLost = m_gapLost + 1;
+    }
+  else if (m_burstLosses > 1)
+    {
+      m_model.bursts = m_model.bursts + 1;
+      m_model.burstPackets = m_model.burstPackets + m_burstPackets;
+      m_burstLost = m_burstLost + m_burstLosses;
+    }
+  m_burstPackets = 0;
+  m_burstLosses = 0;
+}
+
+void
+TpaLossRuns::Close (TpaLossRuns &closed) const
+{
+  closed = *this;
+  closed.CloseBurst ();
+  closed.m_model.gapPackets = closed.m_model.gapPackets + closed.m_sinceLoss;
+  closed.m_sinceLoss = 0;
+  if (closed.m_runLength > 0)
+    {
+      if (closed.m_runLost)
+        {
+          closed.m_lossRuns[GetBin (closed.m_runLength)]++;
+          closed.m_nLossRuns = closed.m_nLossRuns + 1;
+        }
+      else
+        {
+          closed.m_gapRuns[GetBin (closed.m_runLength)]++;
+        }
+      closed.m_runLength = 0;
+    }
+}
+
+void
+TpaLossRuns::Merge (const TpaLossRuns &other)
+{
+  TpaLossRuns closed;
+  other.Close (closed);
+  m_lost = m_lost + closed.m_lost;
+  m_received = m_received + closed.m_received;
+  for (uint32_t i = 0; i < BINS; i++)
+    {
+      m_lossRuns[i] = m_lossRuns[i] + closed.m_lossRuns[i];
+      m_gapRuns[i] = m_gapRuns[i] + closed.m_gapRuns[i];
+    }
+  m_nLossRuns = m_nLossRuns + closed.m_nLossRuns;
+  m_maxLossRun = closed.m_maxLossRun > m_maxLossRun ? closed.m_maxLossRun : m_maxLossRun;
+  m_model.bursts = m_model.bursts + closed.m_model.bursts;
+  m_model.burstPackets = m_model.burstPackets + closed.m_model.burstPackets;
+  m_model.gapPackets = m_model.gapPackets + closed.m_model.gapPackets;
+  m_burstLost = m_burstLost + closed.m_burstLost;
+  m_gapLost = m_gapLost + closed.m_gapLost;
+}
+
+uint32_t
+TpaLossRuns::GetLost (void) const
+{
+  return m_lost;
+}
+
+uint32_t
+TpaLossRuns::GetReceived (void) const
+{
+  return m_received;
+}
+
+uint32_t
+TpaLossRuns::GetLossRuns (uint32_t bin) const
+{
+  TpaLossRuns closed;
+  Close (closed);
+  return closed.m_lossRuns[bin];
+}
+
+uint32_t
+TpaLossRuns::GetGapRuns (uint32_t bin) const
+{
+  TpaLossRuns closed;
+  Close (closed);
+  return closed.m_gapRuns[bin];
+}
+
+uint32_t
+TpaLossRuns::GetMaxLossRun (void) const
+{
+  return m_maxLossRun;
+}
+
+double
+TpaLossRuns::GetMeanLossRun (void) const
+{
+  TpaLossRuns closed;
+  Close (closed);
+  return closed.m_nLossRuns > 0 ? m_lost / double (closed.m_nLossRuns) : 0.0;
+}
+
+TpaGilbertElliott
+TpaLossRuns::GetModel (void) const
+{
+  TpaLossRuns closed;
+  Close (closed);
+  TpaGilbertElliott model = closed.m_model;
+  if (model.gapPackets > 0)
+    {
+      model.p = model.bursts / double (model.gapPackets);
+      model.gapDensity = closed.m_gapLost / double (model.gapPackets);
+    }
+  if (model.burstPackets > 0)
+    {
+      model.r = model.bursts / double (model.burstPackets);
+      model.burstDensity = closed.m_burstLost / double (model.burstPackets);
+    }
+  return model;
+}
+
+double
+TpaLossRuns::GetBurstRatio (void) const
+{
+  TpaLossRuns closed;
+  Close (closed);
+  return GetBurstRatio (m_lost, m_received, closed.m_nLossRuns);
+}
+
+double
+TpaLossRuns::GetBurstRatio (uint32_t lost, uint32_t received, uint32_t lossRuns)
+{
+  if (lost == 0 || received == 0 || lossRuns == 0)
+    {
+      return 1.0;
+    }
+  double p = lossRuns / double (received);
+  double q = lossRuns / double (lost);
+  return 1 / (p + q);
+}
+
+void
+TpaLossRuns::Print (std::ostream &os) const
+{
+  TpaLossRuns closed;
+  Close (closed);
+  const uint32_t *runs[2] = { closed.m_lossRuns, closed.m_gapRuns };
+  const char *names[2] = { "loss_runs", "gap_runs" };
+  for (int k = 0; k < 2; k++)
+    {
+      os << names[k];
+      for (uint32_t i = 0; i < BINS; i++)
+        {
+          if (runs[k][i] > 0)
+            {
+              os << " " << (uint64_t (1) << i) << ":" << runs[k][i];
+            }
+        }
+      os << std::endl;
+    }
+}
+
+void
+TpaLossRuns::Clear (void)
+{
+  m_started = false;
+  m_nextExpected = 0;
+  m_lost = 0;
+  m_received = 0;
+  m_runLost = false;
+  m_runLength = 0;
+  m_maxLossRun = 0;
+  for (uint32_t i = 0; i < BINS; i++)
+    {
+      m_lossRuns[i] = 0;
+      m_gapRuns[i] = 0;
+    }
+  m_nLossRuns = 0;
+  m_sinceLoss = 0;
+  m_burstPackets = 0;
+  m_burstLosses = 0;
+  m_model = TpaGilbertElliott ();
+  m_burstLost = 0;
+  m_gapLost = 0;
+}
+
+} // namespace ns3
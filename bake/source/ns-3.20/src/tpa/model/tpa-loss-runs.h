@@ -0,0 +1,145 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Goran Shekerov <g_sekerov@yahoo.com>
+ */
+
+#ifndef TPA_LOSS_RUNS_H
+#define TPA_LOSS_RUNS_H
+
+#include <stdint.h>
+#include <iostream>
+
+namespace ns3 {
+
+/**
+ * \brief 2-state Gilbert-Elliott loss model, fitted by TpaLossRuns
+ */
+struct TpaGilbertElliott
+{
+  double   p;             //!< probability gap -> burst, per packet in a gap
+  double   r;             //!< probability burst -> gap, per packet in a burst
+  double   burstDensity;  //!< loss probability in a burst (1 - h)
+  double   gapDensity;    //!< loss probability in a gap (k)
+  uint32_t bursts;
+  uint32_t burstPackets;  //!< lost and received packets in the bursts
+  uint32_t gapPackets;
+
+  TpaGilbertElliott ();
+};
+
+/**
+ * \brief Loss-run and gap-run histograms and Gilbert-Elliott fit of one packet stream
+ *
+ * Fed with the received sequence numbers of a flow (AddSeq), the missing
+ * sequence numbers being lost, or directly with AddLost / AddReceived.
+ * A late packet (sequence number already passed) stays lost, it is
+ * counted by TpaReorderWindow; the losses after the last received packet
+ * are not seen.
+ *
+ * The runs of consecutive lost packets (loss runs) and of consecutive
+ * received packets (gap runs) are counted in power-of-two histograms.
+ * The packets are classified in bursts and gaps as in RFC 3611: a burst
+ * starts and ends with a loss and has no Gmin consecutive received packets
+ * in it, a lone loss belongs to the gap.  The bursts are the bad state of
+ * the Gilbert-Elliott model, the gaps the good one.
+ *
+ * Everything is O(1) per call; no memory is allocated.
+ */
+class TpaLossRuns
+{
+public:
+  /// histogram bin i counts the runs of length [2^i, 2^(i+1))
+  static const uint32_t BINS = 32;
+
+  TpaLossRuns ();
+
+  /**
+   * \param gmin minimum number of received packets that ends a burst, 16 in RFC 3611
+   */
+  void SetGmin (uint32_t gmin);
+  uint32_t GetGmin (void) const;
+
+  /**
+   * \param seq sequence number of a received packet, modulo 2^32
+   * \return the number of packets found lost before it
+   */
+  uint32_t AddSeq (uint32_t seq);
+  /// \param count consecutive lost packets
+  void AddLost (uint32_t count);
+  void AddReceived (void);
+  /**
+   * Add the packets of another stream (another flow), its open runs closed
+   */
+  void Merge (const TpaLossRuns &other);
+
+  uint32_t GetLost (void) const;
+  uint32_t GetReceived (void) const;
+  /// \return the loss runs in bin (see BINS), the open run included
+  uint32_t GetLossRuns (uint32_t bin) const;
+  uint32_t GetGapRuns (uint32_t bin) const;
+  uint32_t GetMaxLossRun (void) const;
+  /// \return the mean number of packets of a loss run, 0 without losses
+  double GetMeanLossRun (void) const;
+  /// \return the model of the packets so far, the open burst closed
+  TpaGilbertElliott GetModel (void) const;
+  /// \return the G.107 burst ratio of the packets so far
+  double GetBurstRatio (void) const;
+  /**
+   * G.107 burst ratio 1 / (p + q), p = P(loss | received), q = P(received | loss):
+   * the mean loss run over the mean loss run of random loss
+   * \return 1 without losses
+   */
+  static double GetBurstRatio (uint32_t lost, uint32_t received, uint32_t lossRuns);
+
+  /**
+   * Write "loss_runs" and "gap_runs" lines, non empty bins as "length:count",
+   * length being the bin's shortest run
+   */
+  void Print (std::ostream &os) const;
+  void Clear (void);
+
+private:
+  static uint32_t GetBin (uint32_t length);
+  void CloseBurst (void);
+  // copy of the counters with the open runs and burst closed
+  void Close (TpaLossRuns &closed) const;
+
+  uint32_t m_gmin;
+  bool     m_started;
+  uint32_t m_nextExpected;
+  uint32_t m_lost;
+  uint32_t m_received;
+
+  // current run
+  bool     m_runLost;
+  uint32_t m_runLength;
+  uint32_t m_maxLossRun;
+  uint32_t m_lossRuns[BINS];
+  uint32_t m_gapRuns[BINS];
+  uint32_t m_nLossRuns;
+
+  // burst / gap classification
+  uint32_t m_sinceLoss;         // received packets since the last loss
+  uint32_t m_burstPackets;      // open burst, from its first loss to its last one
+  uint32_t m_burstLosses;
+  TpaGilbertElliott m_model;    // closed bursts; densities computed by GetModel
+  uint32_t m_burstLost;
+  uint32_t m_gapLost;
+};
+
+} // namespace ns3
+
+#endif /* TPA_LOSS_RUNS_H */
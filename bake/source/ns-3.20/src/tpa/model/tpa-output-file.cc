@@ -0,0 +1,113 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Goran Shekerov <g_sekerov@yahoo.com>
+ */
+
+#include "tpa-output-file.h"
+#include <cstdio>
+#include <sstream>
+#include <unistd.h>
+
+namespace ns3 {
+
+TpaOutputFile::TpaOutputFile ()
+{
+}
+
+TpaOutputFile::~TpaOutputFile ()
+{
+  Discard ();
+}
+
+bool
+TpaOutputFile::Open (const std::string &fileName)
+{
+  Discard ();
+  std::ostringstream tempName;
+  tempName << fileName << ".tmp." << getpid ();
+  m_stream.clear ();
+  m_stream.open (tempName.str ().c_str (), std::ios::out | std::ios::trunc);
+  if (!m_stream.is_open ())
+    {
+      return false;
+    }
+  m_fileName = fileName;
+  m_tempName = tempName.str ();
+  return true;
+}
+
+bool
+TpaOutputFile::IsOpen (void) const
+{
+  return !m_tempName.empty ();
+}
+
+std::ostream &
+TpaOutputFile::GetStream (void)
+{
+  return m_stream;
+}
+
+bool
+TpaOutputFile::Commit (void)
+{
+  if (!IsOpen ())
+    {
+      return false;
+    }
+  m_stream.flush ();
+  bool written = m_stream.good ();
+  m_stream.close ();
+  if (!written || std::rename (m_tempName.c_str (), m_fileName.c_str ()) != 0)
+    {
+      std::remove (m_tempName.c_str ());
+      m_tempName.clear ();
+      return false;
+    }
+  m_tempName.clear ();
+  return true;
+}
+
+void
+TpaOutputFile::Discard (void)
+{
+  if (!IsOpen ())
+    {
+      return;
+    }
+  m_stream.close ();
+  std::remove (m_tempName.c_str ());
+  m_tempName.clear ();
+}
+
+std::string
+TpaOutputFile::GetFileName (const std::string &directory, const std::string &name,
+                            const std::string &runId, const std::string &extension)
+{
+  std::string fileName = directory;
+  if (!fileName.empty () && fileName[fileName.size () - 1] != '/')
+    {
+      fileName += '/';
+    }
+  fileName += name;
+  if (!runId.empty ())
+    {
+      fileName += '-' + runId;
+    }
+  return fileName + extension;
+}
+
+} // namespace ns3
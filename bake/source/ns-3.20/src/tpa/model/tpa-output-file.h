@@ -0,0 +1,69 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Goran Shekerov <g_sekerov@yahoo.com>
+ */
+
+#ifndef TPA_OUTPUT_FILE_H
+#define TPA_OUTPUT_FILE_H
+
+#include <fstream>
+#include <string>
+
+namespace ns3 {
+
+/**
+ * \brief Result file replaced atomically
+ *
+ * The file is written as fileName.tmp.<pid> next to fileName and renamed
+ * over it by Commit, so a reader never sees a partly written file and two
+ * processes writing the same file leave one complete copy.  A file not
+ * committed (error, or destroyed before Commit) is removed.
+ */
+class TpaOutputFile
+{
+public:
+  TpaOutputFile ();
+  ~TpaOutputFile ();
+
+  /// \return false if the temporary file can't be created
+  bool Open (const std::string &fileName);
+  bool IsOpen (void) const;
+  std::ostream & GetStream (void);
+  /// \return false if a write or the rename failed; the temporary file is removed
+  bool Commit (void);
+  void Discard (void);
+
+  /**
+   * \param directory output directory, empty for the working directory
+   * \param name file name without extension, e.g. tempresults
+   * \param runId appended to the name after a '-', nothing if empty
+   * \param extension e.g. ".txt"
+   */
+  static std::string GetFileName (const std::string &directory, const std::string &name,
+                                  const std::string &runId, const std::string &extension);
+
+private:
+  TpaOutputFile (const TpaOutputFile &);
+  TpaOutputFile & operator= (const TpaOutputFile &);
+
+  std::ofstream m_stream;
+  std::string   m_fileName;
+  std::string   m_tempName;
+};
+
+} // namespace ns3
+
+#endif /* TPA_OUTPUT_FILE_H */
@@ -0,0 +1,119 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Goran Shekerov <g_sekerov@yahoo.com>
+ */
+
+
+#ifndef TPA_PACKET_VIEW_H
+#define TPA_PACKET_VIEW_H
+
+#include <stdint.h>
+#include "ns3/packet.h"
+
+namespace ns3 {
+
+/**
+ * \brief Read-only view of the first bytes of a packet
+ *
+ * The Tpa callbacks only need a few fields at fixed offsets (next header
+ * values, UDP ports, the SeqTsHeader sequence number, ...).  Instead of
+ * copying the Packet and deserializing every header, the first bytes are
+ * copied once with Packet::CopyData into a small buffer on the stack and
+ * the fields are read from there in network byte order.
+ */
+class TpaPacketView
+{
+public:
+  /// Bytes copied from the start of the packet: Ethernet + 2 IPv6 + extensions + UDP + SeqTs
+  static const uint32_t MAX_PEEK = 192;
+
+  TpaPacketView (Ptr<const Packet> packet);
+  TpaPacketView (const uint8_t *data, uint32_t size);
+
+  /// \return the size of the whole packet
+  uint32_t GetPacketSize (void) const;
+  /// \return true if [offset, offset + length) was copied into the view
+  bool Has (uint32_t offset, uint32_t length) const;
+
+  uint8_t ReadU8 (uint32_t offset) const;
+  uint16_t ReadNtohU16 (uint32_t offset) const;
+  uint32_t ReadNtohU32 (uint32_t offset) const;
+  const uint8_t * PeekData (uint32_t offset) const;
+
+private:
+  uint8_t  m_data[MAX_PEEK];
+  uint32_t m_peeked;
+  uint32_t m_size;
+};
+
+inline
+TpaPacketView::TpaPacketView (Ptr<const Packet> packet)
+{
+  m_size = packet->GetSize ();
+  m_peeked = packet->CopyData (m_data, m_size < MAX_PEEK ? m_size : MAX_PEEK);
+}
+
+inline
+TpaPacketView::TpaPacketView (const uint8_t *data, uint32_t size)
+{
+  m_size = size;
+  m_peeked = size < MAX_PEEK ? size : MAX_PEEK;
+  for (uint32_t i = 0; i < m_peeked; i++)
+    {
+      m_data[i] = data[i];
+    }
+}
+
+inline uint32_t
+TpaPacketView::GetPacketSize (void) const
+{
+  return m_size;
+}
+
+inline bool
+TpaPacketView::Has (uint32_t offset, uint32_t length) const
+{
+  return offset <= m_peeked && length <= m_peeked - offset;
+}
+
+inline uint8_t
+TpaPacketView::ReadU8 (uint32_t offset) const
+{
+  return m_data[offset];
+}
+
+inline uint16_t
+TpaPacketView::ReadNtohU16 (uint32_t offset) const
+{
+  return (uint16_t (m_data[offset]) << 8) | m_data[offset + 1];
+}
+
+inline uint32_t
+TpaPacketView::ReadNtohU32 (uint32_t offset) const
+{
+  return (uint32_t (m_data[offset]) << 24) | (uint32_t (m_data[offset + 1]) << 16)
+         | (uint32_t (m_data[offset + 2]) << 8) | m_data[offset + 3];
+}
+
+inline const uint8_t *
+TpaPacketView::PeekData (uint32_t offset) const
+{
+  return m_data + offset;
+}
+
+} // namespace ns3
+
+#endif /* TPA_PACKET_VIEW_H */
@@ -0,0 +1,253 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Goran Shekerov <g_sekerov@yahoo.com>
+ */
+
+#ifndef TPA_RECORD_STORE_H
+#define TPA_RECORD_STORE_H
+
+#include <stdint.h>
+#include <cstddef>
+#include <vector>
+#include "ns3/assert.h"
+
+namespace ns3 {
+
+/**
+ * \brief Growable chunked store for per-packet records
+ *
+ * Records are appended into fixed-size blocks (chunks) that are allocated
+ * only when the previous one is full, so the memory used follows the real
+ * number of loaded packets and there is no upper limit.  Already stored
+ * records are never moved, so references stay valid while the store grows.
+ *
+ * T is expected to be a plain struct or number (the columns of the Tpa
+ * packet records).  The records of a chunk are contiguous, the kernels
+ * (TpaKernels) run over them chunk by chunk; two stores of the same size
+ * have the same chunks.
+ */
+template <typename T, std::size_t CHUNK_SIZE = 1024>
+class TpaRecordStore
+{
+public:
+  TpaRecordStore ();
+  ~TpaRecordStore ();
+
+  /**
+   * Append one record at the end of the store
+   * \param record the record to copy in
+   */
+  void Push (const T &record);
+  /**
+   * \return a reference to a new zero-initialized record at the end of the store
+   */
+  T & Append (void);
+  /**
+   * Grow the store to size records; the new records are zero-initialized
+   */
+  void Resize (std::size_t size);
+
+  T & operator[] (std::size_t i);
+  const T & operator[] (std::size_t i) const;
+  T & Back (void);
+  const T & Back (void) const;
+
+  std::size_t GetSize (void) const;
+  bool IsEmpty (void) const;
+  /// \return the number of chunks holding records
+  std::size_t GetNChunks (void) const;
+  /// \return the first record of chunk c
+  T * GetChunk (std::size_t c);
+  const T * GetChunk (std::size_t c) const;
+  /// \return the number of records in chunk c, CHUNK_SIZE but in the last one
+  std::size_t GetChunkLength (std::size_t c) const;
+  /**
+   * \return the number of bytes held by the allocated chunks
+   */
+  std::size_t GetMemoryUsage (void) const;
+
+  /**
+   * Forget all records; the allocated chunks are kept for reuse
+   */
+  void Reset (void);
+  /**
+   * Forget all records and release the allocated chunks
+   */
+  void Clear (void);
+
+private:
+  // not copyable, the chunks are owned by the store
+  TpaRecordStore (const TpaRecordStore &);
+  TpaRecordStore & operator= (const TpaRecordStore &);
+
+  std::vector<T *> m_chunks;
+  std::size_t      m_size;
+};
+
+template <typename T, std::size_t CHUNK_SIZE>
+TpaRecordStore<T, CHUNK_SIZE>::TpaRecordStore ()
+  : m_size (0)
+{
+}
+
+template <typename T, std::size_t CHUNK_SIZE>
+TpaRecordStore<T, CHUNK_SIZE>::~TpaRecordStore ()
+{
+  Clear ();
+}
+
+template <typename T, std::size_t CHUNK_SIZE>
+inline void
+TpaRecordStore<T, CHUNK_SIZE>::Push (const T &record)
+{
+  Append () = record;
+}
+
+template <typename T, std::size_t CHUNK_SIZE>
+inline T &
+TpaRecordStore<T, CHUNK_SIZE>::Append (void)
+{
+  std::size_t chunk = m_size / CHUNK_SIZE;
+  if (chunk == m_chunks.size ())
+    {
+      m_chunks.push_back (new T[CHUNK_SIZE]);
+    }
+  T &record = m_chunks[chunk][m_size % CHUNK_SIZE];
+  record = T ();
+  m_size = m_size + 1;
+  return record;
+}
+
+template <typename T, std::size_t CHUNK_SIZE>
+void
+TpaRecordStore<T, CHUNK_SIZE>::Resize (std::size_t size)
+{
+  NS_ASSERT (size >= m_size);
+  while (m_chunks.size () * CHUNK_SIZE < size)
+    {
+      m_chunks.push_back (new T[CHUNK_SIZE]);
+    }
+  for (std::size_t i = m_size; i < size; i++)
+    {
+      m_chunks[i / CHUNK_SIZE][i % CHUNK_SIZE] = T ();
+    }
+  m_size = size;
+}
+
+template <typename T, std::size_t CHUNK_SIZE>
+inline T &
+TpaRecordStore<T, CHUNK_SIZE>::operator[] (std::size_t i)
+{
+  NS_ASSERT (i < m_size);
+  return m_chunks[i / CHUNK_SIZE][i % CHUNK_SIZE];
+}
+
+template <typename T, std::size_t CHUNK_SIZE>
+inline const T &
+TpaRecordStore<T, CHUNK_SIZE>::operator[] (std::size_t i) const
+{
+  NS_ASSERT (i < m_size);
+  return m_chunks[i / CHUNK_SIZE][i % CHUNK_SIZE];
+}
+
+template <typename T, std::size_t CHUNK_SIZE>
+inline T &
+TpaRecordStore<T, CHUNK_SIZE>::Back (void)
+{
+  return (*this)[m_size - 1];
+}
+
+template <typename T, std::size_t CHUNK_SIZE>
+inline const T &
+TpaRecordStore<T, CHUNK_SIZE>::Back (void) const
+{
+  return (*this)[m_size - 1];
+}
+
+template <typename T, std::size_t CHUNK_SIZE>
+inline std::size_t
+TpaRecordStore<T, CHUNK_SIZE>::GetSize (void) const
+{
+  return m_size;
+}
+
+template <typename T, std::size_t CHUNK_SIZE>
+inline bool
+TpaRecordStore<T, CHUNK_SIZE>::IsEmpty (void) const
+{
+  return m_size == 0;
+}
+
+template <typename T, std::size_t CHUNK_SIZE>
+inline std::size_t
+TpaRecordStore<T, CHUNK_SIZE>::GetNChunks (void) const
+{
+  return (m_size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+}
+
+template <typename T, std::size_t CHUNK_SIZE>
+inline T *
+TpaRecordStore<T, CHUNK_SIZE>::GetChunk (std::size_t c)
+{
+  NS_ASSERT (c < GetNChunks ());
+  return m_chunks[c];
+}
+
+template <typename T, std::size_t CHUNK_SIZE>
+inline const T *
+TpaRecordStore<T, CHUNK_SIZE>::GetChunk (std::size_t c) const
+{
+  NS_ASSERT (c < GetNChunks ());
+  return m_chunks[c];
+}
+
+template <typename T, std::size_t CHUNK_SIZE>
+inline std::size_t
+TpaRecordStore<T, CHUNK_SIZE>::GetChunkLength (std::size_t c) const
+{
+  NS_ASSERT (c < GetNChunks ());
+  return c + 1 < GetNChunks () ? CHUNK_SIZE : m_size - c * CHUNK_SIZE;
+}
+
+template <typename T, std::size_t CHUNK_SIZE>
+std::size_t
+TpaRecordStore<T, CHUNK_SIZE>::GetMemoryUsage (void) const
+{
+  return m_chunks.size () * CHUNK_SIZE * sizeof (T);
+}
+
+template <typename T, std::size_t CHUNK_SIZE>
+void
+TpaRecordStore<T, CHUNK_SIZE>::Reset (void)
+{
+  m_size = 0;
+}
+
+template <typename T, std::size_t CHUNK_SIZE>
+void
+TpaRecordStore<T, CHUNK_SIZE>::Clear (void)
+{
+  for (std::size_t i = 0; i < m_chunks.size (); i++)
+    {
+      delete [] m_chunks[i];
+    }
+  m_chunks.clear ();
+  m_size = 0;
+}
+
+} // namespace ns3
+
+#endif /* TPA_RECORD_STORE_H */
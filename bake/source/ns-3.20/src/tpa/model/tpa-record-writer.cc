@@ -0,0 +1,250 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Goran Shekerov <g_sekerov@yahoo.com>
+ */
+
+
+#include "tpa-record-writer.h"
+#include "ns3/assert.h"
+#include "ns3/callback.h"
+#include <cstring>
+#include <unistd.h>
+
+namespace ns3 {
+
+const uint32_t TpaRecordWriter::VERSION;
+const uint32_t TpaRecordWriter::HEADER_SIZE;
+const uint32_t TpaRecordWriter::BLOCK_RECORDS;
+const uint32_t TpaRecordWriter::BLOCK_SIZE;
+
+TpaRecordWriter::TpaRecordWriter ()
+  : m_file (0),
+    m_written (0),
+    m_queueCapacity (0),
+    m_dropWhenFull (false),
+    m_queue (0),
+    m_stop (0),
+    m_dropped (0),
+    m_stalls (0)
+{
+  m_blocks[SENT] = 0;
+  m_blocks[RECEIVED] = 0;
+  m_records[SENT] = 0;
+  m_records[RECEIVED] = 0;
+}
+
+TpaRecordWriter::~TpaRecordWriter ()
+{
+  Close ();
+}
+
+void
+TpaRecordWriter::SetQueue (uint32_t capacity, bool dropWhenFull)
+{
+  m_queueCapacity = capacity;
+  m_dropWhenFull = dropWhenFull;
+}
+
+bool
+TpaRecordWriter::Open (const std::string &fileName)
+{
+  NS_ASSERT (sizeof (Block) == BLOCK_SIZE);
+  Close ();
+  m_file = std::fopen (fileName.c_str (), "wb");
+  if (m_file == 0)
+    {
+      return false;
+    }
+  for (uint32_t kind = SENT; kind <= RECEIVED; kind++)
+    {
+      m_blocks[kind] = new Block;
+      std::memset (m_blocks[kind], 0, sizeof (Block));
+      m_blocks[kind]->kind = kind;
+      m_records[kind] = 0;
+    }
+  m_written = 0;
+  m_dropped = 0;
+  m_stalls = 0;
+  WriteHeader ();
+
+  if (m_queueCapacity > 0)
+    {
+      m_queue = new TpaSpscRing<Record> (m_queueCapacity);
+      m_stop = 0;
+      m_thread = Create<SystemThread> (MakeCallback (&TpaRecordWriter::WriterThread, this));
+      m_thread->Start ();
+    }
+  return true;
+}
+
+bool
+TpaRecordWriter::IsOpen (void) const
+{
+  return m_file != 0;
+}
+
+void
+TpaRecordWriter::Add (Kind kind, uint32_t seq, int64_t timeNs, uint32_t size, uint32_t flow, uint8_t path)
+{
+  if (m_file == 0)
+    {
+      return;
+    }
+  Record record;
+  record.timeNs = timeNs;
+  record.seq = seq;
+  record.size = size;
+  record.flow = flow;
+  record.kind = kind;
+  record.path = path;
+
+  if (m_queue == 0)
+    {
+      Store (record);
+    }
+  else if (!m_queue->TryPush (record))
+    {
+      if (m_dropWhenFull)
+        {
+          m_dropped = m_dropped + 1;
+          return;
+        }
+      m_stalls = m_stalls + 1;
+      while (!m_queue->TryPush (record))
+        {
+          usleep (50);
+        }
+    }
+  m_records[kind] = m_records[kind] + 1;
+}
+
+void
+TpaRecordWriter::Store (const Record &record)
+{
+  Block &block = *m_blocks[record.kind];
+  uint32_t i = block.count;
+  block.seq[i] = record.seq;
+  block.timeNs[i] = record.timeNs;
+  block.size[i] = record.size;
+  block.flow[i] = record.flow;
+  block.path[i] = record.path;
+  block.count = i + 1;
+  if (block.count == BLOCK_RECORDS)
+    {
+      WriteBlock (block);
+    }
+}
+
+void
+TpaRecordWriter::WriterThread (void)
+{
+  // the blocks are only touched by this thread until Close joins it
+  Record record;
+  while (true)
+    {
+      uint32_t stop = __atomic_load_n (&m_stop, __ATOMIC_ACQUIRE); // the records pushed before the stop are seen below
+      bool idle = true;
+      while (m_queue->TryPop (record))
+        {
+          Store (record);
+          idle = false;
+        }
+      if (stop)
+        {
+          return;
+        }
+      if (idle)
+        {
+          usleep (200);
+        }
+    }
+}
+
+void
+TpaRecordWriter::WriteBlock (Block &block)
+{
+  std::fwrite (&block, sizeof (Block), 1, m_file);
+  m_written = m_written + 1;
+  block.count = 0;
+}
+
+void
+TpaRecordWriter::WriteHeader (void)
+{
+  TpaRecordFileHeader header;
+  std::memset (&header, 0, sizeof (header));
+  std::memcpy (header.magic, "TPAREC", 6);
+  header.byteOrder = 0x01020304;
+  header.version = VERSION;
+  header.headerSize = HEADER_SIZE;
+  header.blockRecords = BLOCK_RECORDS;
+  header.blockSize = BLOCK_SIZE;
+  header.blocks = m_written;
+  header.sentRecords = m_records[SENT];
+  header.receivedRecords = m_records[RECEIVED];
+  std::fseek (m_file, 0, SEEK_SET);
+  std::fwrite (&header, sizeof (header), 1, m_file);
+  std::fseek (m_file, 0, SEEK_END);
+}
+
+void
+TpaRecordWriter::Close (void)
+{
+  if (m_file == 0)
+    {
+      return;
+    }
+  if (m_queue != 0)
+    {
+      __atomic_store_n (&m_stop, 1, __ATOMIC_RELEASE);
+      m_thread->Join ();
+      m_thread = 0;
+      delete m_queue;
+      m_queue = 0;
+    }
+  for (uint32_t kind = SENT; kind <= RECEIVED; kind++)
+    {
+      if (m_blocks[kind]->count > 0)
+        {
+          WriteBlock (*m_blocks[kind]);
+        }
+      delete m_blocks[kind];
+      m_blocks[kind] = 0;
+    }
+  WriteHeader ();
+  std::fclose (m_file);
+  m_file = 0;
+}
+
+uint64_t
+TpaRecordWriter::GetRecords (Kind kind) const
+{
+  return m_records[kind];
+}
+
+uint64_t
+TpaRecordWriter::GetDropped (void) const
+{
+  return m_dropped;
+}
+
+uint64_t
+TpaRecordWriter::GetStalls (void) const
+{
+  return m_stalls;
+}
+
+} // namespace ns3
@@ -0,0 +1,176 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Goran Shekerov <g_sekerov@yahoo.com>
+ */
+
+
+#ifndef TPA_RECORD_WRITER_H
+#define TPA_RECORD_WRITER_H
+
+#include <stdint.h>
+#include <cstdio>
+#include <string>
+#include "ns3/ptr.h"
+#include "ns3/system-thread.h"
+#include "tpa-spsc-ring.h"
+
+namespace ns3 {
+
+/**
+ * \brief Binary columnar writer of the per-packet records
+ *
+ * File layout, host byte order (the header tells which), every field
+ * naturally aligned so the file can be mmap'ed and the columns read as
+ * plain arrays:
+ *
+ *   header, HEADER_SIZE bytes (TpaRecordFileHeader)
+ *   block 0, BLOCK_SIZE bytes
+ *   block 1, ...
+ *
+ * Every block holds up to BLOCK_RECORDS records of one kind (sent or
+ * received) stored column by column:
+ *
+ *   uint32_t kind, count
+ *   uint32_t seq[BLOCK_RECORDS]
+ *   int64_t  timeNs[BLOCK_RECORDS]
+ *   uint16_t size[BLOCK_RECORDS]     (bytes)
+ *   uint16_t flow[BLOCK_RECORDS]     (TpaFlowTable flow number)
+ *   uint8_t  path[BLOCK_RECORDS]     (TpaPathFlag bits)
+ *
+ * Only the first count entries of a column are valid; the last block of
+ * each kind is the only one that may be partly filled.  Block k starts at
+ * HEADER_SIZE + k * BLOCK_SIZE.  The record counts in the header are
+ * written by Close.
+ *
+ * With a queue (SetQueue) the records are handed to a background writer
+ * thread through a lock-free ring (TpaSpscRing) and the thread fills the
+ * blocks and writes them, so the simulator thread never waits for the
+ * disk.  When the ring is full, Add either waits for the writer thread
+ * (backpressure, nothing is lost) or drops the record and counts it.
+ *
+ * Tpa writes every loaded packet with it when its attribute RecordFile is
+ * set (RecordQueue, RecordDropWhenFull).
+ */
+struct TpaRecordFileHeader
+{
+  char     magic[8];        //!< "TPAREC\0\0"
+  uint32_t byteOrder;       //!< 0x01020304 written in host order
+  uint32_t version;
+  uint32_t headerSize;
+  uint32_t blockRecords;
+  uint32_t blockSize;
+  uint32_t blocks;
+  uint64_t sentRecords;
+  uint64_t receivedRecords;
+  uint8_t  reserved[16];
+};
+
+class TpaRecordWriter
+{
+public:
+  enum Kind
+  {
+    SENT = 0,
+    RECEIVED = 1
+  };
+  static const uint32_t VERSION = 1;
+  static const uint32_t HEADER_SIZE = 64;
+  static const uint32_t BLOCK_RECORDS = 4096;
+  static const uint32_t BLOCK_SIZE = 8 + BLOCK_RECORDS * (4 + 8 + 2 + 2 + 1);
+
+  TpaRecordWriter ();
+  ~TpaRecordWriter ();
+
+  /**
+   * Use a background writer thread for the next files
+   * \param capacity records in the queue, 0 to write from the thread calling Add
+   * \param dropWhenFull drop (and count) the records that find the queue full
+   *        instead of waiting for the writer thread
+   */
+  void SetQueue (uint32_t capacity, bool dropWhenFull);
+  /**
+   * Create the file and write a header without counts; closes the previous file
+   * \return false if the file can't be created
+   */
+  bool Open (const std::string &fileName);
+  bool IsOpen (void) const;
+  /**
+   * Add one record, written when its block is full; does nothing if the file is not open
+   */
+  void Add (Kind kind, uint32_t seq, int64_t timeNs, uint32_t size, uint32_t flow, uint8_t path);
+  /**
+   * Write the partly filled blocks and the final header, and close the file
+   */
+  void Close (void);
+
+  /// \return the records accepted by Add (and written, once the file is closed)
+  uint64_t GetRecords (Kind kind) const;
+  /// \return the records dropped because the queue was full
+  uint64_t GetDropped (void) const;
+  /// \return the number of times Add waited for the writer thread
+  uint64_t GetStalls (void) const;
+
+private:
+  // not copyable, owns the file
+  TpaRecordWriter (const TpaRecordWriter &);
+  TpaRecordWriter & operator= (const TpaRecordWriter &);
+
+  // one block being filled, the layout of the file
+  struct Block
+  {
+    uint32_t kind;
+    uint32_t count;
+    uint32_t seq[BLOCK_RECORDS];
+    int64_t  timeNs[BLOCK_RECORDS];
+    uint16_t size[BLOCK_RECORDS];
+    uint16_t flow[BLOCK_RECORDS];
+    uint8_t  path[BLOCK_RECORDS];
+  };
+
+  // one record in the queue
+  struct Record
+  {
+    int64_t  timeNs;
+    uint32_t seq;
+    uint16_t size;
+    uint16_t flow;
+    uint8_t  kind;
+    uint8_t  path;
+  };
+
+  void Store (const Record &record);
+  void WriteBlock (Block &block);
+  void WriteHeader (void);
+  void WriterThread (void);
+
+  std::FILE *m_file;
+  Block     *m_blocks[2];   // SENT, RECEIVED
+  uint32_t   m_written;     // blocks in the file
+  uint64_t   m_records[2];
+
+  // background writer
+  uint32_t   m_queueCapacity;
+  bool       m_dropWhenFull;
+  TpaSpscRing<Record> *m_queue;
+  Ptr<SystemThread>    m_thread;
+  volatile uint32_t    m_stop;
+  uint64_t   m_dropped;
+  uint64_t   m_stalls;
+};
+
+} // namespace ns3
+
+#endif /* TPA_RECORD_WRITER_H */
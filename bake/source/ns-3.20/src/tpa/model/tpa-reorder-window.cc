@@ -0,0 +1,204 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Goran Shekerov <g_sekerov@yahoo.com>
+ */
+
+#include "tpa-reorder-window.h"
+#include "ns3/assert.h"
+
+namespace ns3 {
+
+TpaReorderWindow::TpaReorderWindow ()
+  : m_mask (0)
+{
+  SetSize (1024);
+}
+
+TpaReorderWindow::TpaReorderWindow (uint32_t size)
+  : m_mask (0)
+{
+  SetSize (size);
+}
+
+void
+TpaReorderWindow::SetSize (uint32_t size)
+{
+  Clear ();
+  if (size == 0)
+    {
+      m_received.clear ();
+      m_history.clear ();
+      m_mask = 0;
+      return;
+    }
+  uint32_t slots = 1;
+  while (slots < size)
+    {
+      slots = slots * 2;
+    }
+  m_mask = slots - 1;
+  m_received.assign (slots, false);
+  m_history.assign (slots, 0);
+}
+
+uint32_t
+TpaReorderWindow::GetSize (void) const
+{
+  return m_history.size ();
+}
+
+bool
+TpaReorderWindow::IsAfter (uint32_t a, uint32_t b)
+{
+  return int32_t (a - b) > 0;
+}
+
+TpaReorderWindow::Result
+TpaReorderWindow::Add (uint32_t seq, uint32_t &extent)
+{
+  NS_ASSERT_MSG (!m_history.empty (), "TpaReorderWindow used before SetSize");
+  uint32_t size = m_mask + 1;
+  extent = 0;
+  if (!m_started || !IsAfter (m_nextExpected, seq))
+    {
+      // in order, maybe after a gap: forget the bits the window slides over
+      uint32_t gap = m_started ? seq - m_nextExpected : 0;
+      for (uint32_t k = 0; k < gap && k < size; k++)
+        {
+          m_received[(m_nextExpected + k) & m_mask] = false;
+        }
+      m_started = true;
+      m_received[seq & m_mask] = true;
+      m_nextExpected = seq + 1;
+      m_history[m_arrivals & m_mask] = seq;
+      m_arrivals = m_arrivals + 1;
+      return IN_ORDER;
+    }
+
+  if (m_nextExpected - seq <= size)
+    {
+      if (m_received[seq & m_mask])
+        {
+          return DUPLICATE;
+        }
+      m_received[seq & m_mask] = true;
+    }
+
+  // the earliest remembered arrival with a bigger sequence number
+  uint64_t oldest = m_arrivals > size ? m_arrivals - size : 0;
+  for (uint64_t k = oldest; k < m_arrivals; k++)
+    {
+      if (IsAfter (m_history[k & m_mask], seq))
+        {
+          if (k > oldest || oldest == 0)
+            {
+              extent = uint32_t (m_arrivals - k);
+            }
+          break;
+        }
+    }
+  m_history[m_arrivals & m_mask] = seq;
+  m_arrivals = m_arrivals + 1;
+  return REORDERED;
+}
+
+void
+TpaReorderWindow::Clear (void)
+{
+  m_received.assign (m_received.size (), false);
+  m_nextExpected = 0;
+  m_arrivals = 0;
+  m_started = false;
+}
+
+const uint32_t TpaReorderStats::MAX_EXTENT;
+
+TpaReorderStats::TpaReorderStats ()
+{
+  Clear ();
+}
+
+void
+TpaReorderStats::Add (TpaReorderWindow::Result result, uint32_t extent)
+{
+  if (result == TpaReorderWindow::DUPLICATE)
+    {
+      m_duplicates = m_duplicates + 1;
+      return;
+    }
+  m_received = m_received + 1;
+  if (result == TpaReorderWindow::REORDERED)
+    {
+      m_reordered = m_reordered + 1;
+      uint32_t bin = (extent == 0 || extent > MAX_EXTENT) ? MAX_EXTENT : extent;
+      m_extents[bin] = m_extents[bin] + 1;
+    }
+}
+
+uint32_t
+TpaReorderStats::GetReceived (void) const
+{
+  return m_received;
+}
+
+uint32_t
+TpaReorderStats::GetReordered (void) const
+{
+  return m_reordered;
+}
+
+uint32_t
+TpaReorderStats::GetDuplicates (void) const
+{
+  return m_duplicates;
+}
+
+double
+TpaReorderStats::GetReorderedRatio (void) const
+{
+  return m_received > 0 ? m_reordered / double (m_received) * 100 : 0.0;
+}
+
+uint32_t
+TpaReorderStats::GetExtentCount (uint32_t extent) const
+{
+  return extent <= MAX_EXTENT ? m_extents[extent] : 0;
+}
+
+void
+TpaReorderStats::Print (std::ostream &os) const
+{
+  const char *separator = "";
+  for (uint32_t extent = 1; extent <= MAX_EXTENT; extent++)
+    {
+      if (m_extents[extent] > 0)
+        {
+          os << separator << (extent == MAX_EXTENT ? ">=" : "") << extent << ":" << m_extents[extent];
+          separator = " ";
+        }
+    }
+}
+
+void
+TpaReorderStats::Clear (void)
+{
+  m_received = 0;
+  m_reordered = 0;
+  m_duplicates = 0;
+  m_extents.assign (MAX_EXTENT + 1, 0);
+}
+
+} // namespace ns3
@@ -0,0 +1,122 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Goran Shekerov <g_sekerov@yahoo.com>
+ */
+
+#ifndef TPA_REORDER_WINDOW_H
+#define TPA_REORDER_WINDOW_H
+
+#include <stdint.h>
+#include <vector>
+#include <iostream>
+
+namespace ns3 {
+
+/**
+ * \brief Reordering and duplicate detection of the packets of one flow
+ *
+ * Follows RFC 4737: a packet is reordered when its sequence number is
+ * smaller than the next expected one (the biggest received + 1), and its
+ * reorder extent is the number of packets received between the first
+ * packet with a bigger sequence number and itself.  A sequence number
+ * received twice is a duplicate (RFC 5560) and is not counted again.
+ *
+ * Only the last "size" sequence numbers are remembered (one bit each)
+ * along with the sequence numbers of the last "size" arrivals, so the
+ * memory is O(size).  A packet older than that is still reordered, but
+ * its extent is unknown and it can't be told from a duplicate.
+ * Sequence numbers are compared modulo 2^32.
+ */
+class TpaReorderWindow
+{
+public:
+  enum Result
+  {
+    IN_ORDER,
+    REORDERED,
+    DUPLICATE
+  };
+
+  TpaReorderWindow ();
+  /**
+   * \param size remembered sequence numbers and arrivals, rounded up to a
+   *        power of two; 0 allocates nothing until SetSize is called
+   */
+  TpaReorderWindow (uint32_t size);
+
+  /**
+   * Resize the window; the content is dropped
+   */
+  void SetSize (uint32_t size);
+  uint32_t GetSize (void) const;
+
+  /**
+   * \param seq sequence number of the received packet
+   * \param extent set to the reorder extent of a reordered packet, 0 when
+   *        it is beyond the window
+   */
+  Result Add (uint32_t seq, uint32_t &extent);
+  void Clear (void);
+
+private:
+  static bool IsAfter (uint32_t a, uint32_t b);
+
+  std::vector<bool>     m_received; // indexed by seq & m_mask, for seq in [m_nextExpected - size, m_nextExpected)
+  std::vector<uint32_t> m_history;  // sequence number of arrival k at k & m_mask
+  uint32_t m_mask;
+  uint32_t m_nextExpected;
+  uint64_t m_arrivals;              // not counting the duplicates
+  bool     m_started;
+};
+
+/**
+ * \brief Reordering and duplicate counters, with a histogram of the reorder extents
+ */
+class TpaReorderStats
+{
+public:
+  /// the last bin of the histogram counts this extent and above, and the unknown ones
+  static const uint32_t MAX_EXTENT = 64;
+
+  TpaReorderStats ();
+  void Add (TpaReorderWindow::Result result, uint32_t extent);
+
+  /// \return the received packets, not counting the duplicates
+  uint32_t GetReceived (void) const;
+  uint32_t GetReordered (void) const;
+  uint32_t GetDuplicates (void) const;
+  /// \return reordered packets over received packets [%]
+  double GetReorderedRatio (void) const;
+  /// \return the number of packets with reorder extent extent (1 .. MAX_EXTENT)
+  uint32_t GetExtentCount (uint32_t extent) const;
+
+  /**
+   * Write the non empty bins as "extent:count", separated by spaces,
+   * the last one as ">=64:count"
+   */
+  void Print (std::ostream &os) const;
+  void Clear (void);
+
+private:
+  uint32_t m_received;
+  uint32_t m_reordered;
+  uint32_t m_duplicates;
+  std::vector<uint32_t> m_extents;  // index = extent, 0 unused
+};
+
+} // namespace ns3
+
+#endif /* TPA_REORDER_WINDOW_H */
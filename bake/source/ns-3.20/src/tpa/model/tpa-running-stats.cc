@@ -0,0 +1,119 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Goran Shekerov <g_sekerov@yahoo.com>
+ */
+
+
+#include "tpa-running-stats.h"
+#include <math.h>
+
+namespace ns3 {
+
+TpaRunningStats::TpaRunningStats ()
+{
+  Reset ();
+}
+
+void
+TpaRunningStats::Add (double x)
+{
+  m_count = m_count + 1;
+  double d = x - m_mean;
+  m_mean = m_mean + d / m_count;
+  m_m2 = m_m2 + d * (x - m_mean);
+  if (m_count == 1 || x < m_min) {m_min = x;}
+  if (m_count == 1 || x > m_max) {m_max = x;}
+}
+
+void
+TpaRunningStats::Merge (const TpaRunningStats &other)
+{
+  if (other.m_count == 0)
+    {
+      return;
+    }
+  if (m_count == 0)
+    {
+      *this = other;
+      return;
+    }
+  double n1 = m_count;
+  double n2 = other.m_count;
+  double d = other.m_mean - m_mean;
+  m_mean = m_mean + d * n2 / (n1 + n2);
+  m_m2 = m_m2 + other.m_m2 + d * d * n1 * n2 / (n1 + n2);
+  m_count = m_count + other.m_count;
+  if (other.m_min < m_min) {m_min = other.m_min;}
+  if (other.m_max > m_max) {m_max = other.m_max;}
+}
+
+void
+TpaRunningStats::Reset (void)
+{
+  m_count = 0;
+  m_mean = 0.0;
+  m_m2 = 0.0;
+  m_min = 0.0;
+  m_max = 0.0;
+}
+
+uint64_t
+TpaRunningStats::GetCount (void) const
+{
+  return m_count;
+}
+
+double
+TpaRunningStats::GetSum (void) const
+{
+  return m_mean * m_count;
+}
+
+double
+TpaRunningStats::GetMean (void) const
+{
+  return m_mean;
+}
+
+double
+TpaRunningStats::GetVariance (void) const
+{
+  if (m_count < 2)
+    {
+      return 0.0;
+    }
+  return m_m2 / (m_count - 1);
+}
+
+double
+TpaRunningStats::GetStdDev (void) const
+{
+  return sqrt (GetVariance ());
+}
+
+double
+TpaRunningStats::GetMin (void) const
+{
+  return m_min;
+}
+
+double
+TpaRunningStats::GetMax (void) const
+{
+  return m_max;
+}
+
+} // namespace ns3
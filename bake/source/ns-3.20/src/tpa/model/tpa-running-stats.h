@@ -0,0 +1,63 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Goran Shekerov <g_sekerov@yahoo.com>
+ */
+
+
+#ifndef TPA_RUNNING_STATS_H
+#define TPA_RUNNING_STATS_H
+
+#include <stdint.h>
+
+namespace ns3 {
+
+/**
+ * \brief Running mean/variance/min/max of a sample stream
+ *
+ * Welford's online algorithm, so the statistics are updated in O(1) per
+ * sample without keeping the samples.  Two accumulators can be merged
+ * (Chan et al. parallel formula), e.g. to pool flows or replications.
+ */
+class TpaRunningStats
+{
+public:
+  TpaRunningStats ();
+
+  void Add (double x);
+  void Merge (const TpaRunningStats &other);
+  void Reset (void);
+
+  uint64_t GetCount (void) const;
+  double GetSum (void) const;
+  /// \return the mean, 0 when there are no samples
+  double GetMean (void) const;
+  /// \return the sample variance, 0 with less than two samples
+  double GetVariance (void) const;
+  double GetStdDev (void) const;
+  double GetMin (void) const;
+  double GetMax (void) const;
+
+private:
+  uint64_t m_count;
+  double   m_mean;
+  double   m_m2;   // sum of squared differences from the mean
+  double   m_min;
+  double   m_max;
+};
+
+} // namespace ns3
+
+#endif /* TPA_RUNNING_STATS_H */
@@ -0,0 +1,179 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Goran Shekerov <g_sekerov@yahoo.com>
+ */
+
+#include "tpa-seq-index.h"
+
+namespace ns3 {
+
+const uint32_t TpaSeqIndex::NOT_FOUND;
+const uint32_t TpaSeqIndex::TAKEN;
+
+TpaSeqIndex::TpaSeqIndex ()
+  : m_flat (true),
+    m_base (0),
+    m_mask (0)
+{
+}
+
+uint64_t
+TpaSeqIndex::MakeKey (uint32_t flow, uint32_t seq)
+{
+  return (uint64_t (flow) << 32) | seq;
+}
+
+uint32_t
+TpaSeqIndex::Hash (uint64_t seq)
+{
+  return uint32_t ((seq * 0x9e3779b97f4a7c15ULL) >> 32); // Fibonacci hashing
+}
+
+void
+TpaSeqIndex::Prepare (uint64_t minSeq, uint64_t maxSeq, std::size_t count)
+{
+  Clear ();
+  uint64_t range = maxSeq - minSeq + 1;
+
+  // a flat array up to 4 slots per packet is still cheaper than hashing
+  if (range != 0 && range <= 4 * uint64_t (count) + 1024)
+    {
+      m_flat = true;
+      m_base = minSeq;
+      m_values.assign (range, NOT_FOUND);
+      return;
+    }
+
+  // load factor kept under 0.5 to keep the probe sequences short
+  uint32_t capacity = 16;
+  while (capacity < 2 * count)
+    {
+      capacity = capacity * 2;
+    }
+  m_flat = false;
+  m_mask = capacity - 1;
+  m_keys.assign (capacity, 0);
+  m_values.assign (capacity, NOT_FOUND);
+  m_used.assign (capacity, false);
+}
+
+bool
+TpaSeqIndex::Insert (uint64_t seq, uint32_t value)
+{
+  if (m_flat)
+    {
+      uint64_t slot = seq - m_base;
+      if (seq < m_base || slot >= m_values.size ())
+        {
+          return false;
+        }
+      if (m_values[slot] != NOT_FOUND)
+        {
+          return false;
+        }
+      m_values[slot] = value;
+      return true;
+    }
+
+  uint32_t slot = Hash (seq) & m_mask;
+  while (m_used[slot])
+    {
+      if (m_keys[slot] == seq)
+        {
+          return false;
+        }
+      slot = (slot + 1) & m_mask;
+    }
+  m_used[slot] = true;
+  m_keys[slot] = seq;
+  m_values[slot] = value;
+  return true;
+}
+
+uint32_t *
+TpaSeqIndex::Lookup (uint64_t seq)
+{
+  if (m_flat)
+    {
+      uint64_t slot = seq - m_base;
+      if (seq < m_base || slot >= m_values.size ())
+        {
+          return 0;
+        }
+      return &m_values[slot];
+    }
+
+  if (m_used.empty ())
+    {
+      return 0;
+    }
+  uint32_t slot = Hash (seq) & m_mask;
+  while (m_used[slot])
+    {
+      if (m_keys[slot] == seq)
+        {
+          return &m_values[slot];
+        }
+      slot = (slot + 1) & m_mask;
+    }
+  return 0;
+}
+
+uint32_t
+TpaSeqIndex::Find (uint64_t seq) const
+{
+  uint32_t *value = const_cast<TpaSeqIndex *> (this)->Lookup (seq);
+  if (value == 0 || *value == TAKEN)
+    {
+      return NOT_FOUND;
+    }
+  return *value;
+}
+
+uint32_t
+TpaSeqIndex::Take (uint64_t seq)
+{
+  uint32_t *value = Lookup (seq);
+  if (value == 0 || *value == TAKEN)
+    {
+      return NOT_FOUND;
+    }
+  uint32_t found = *value;
+  if (found != NOT_FOUND)
+    {
+      *value = TAKEN;
+    }
+  return found;
+}
+
+bool
+TpaSeqIndex::IsFlat (void) const
+{
+  return m_flat;
+}
+
+void
+TpaSeqIndex::Clear (void)
+{
+  m_flat = true;
+  m_base = 0;
+  m_mask = 0;
+  m_values.clear ();
+  m_keys.clear ();
+  m_used.clear ();
+}
+
+} // namespace ns3
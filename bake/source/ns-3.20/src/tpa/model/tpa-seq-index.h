@@ -0,0 +1,97 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Goran Shekerov <g_sekerov@yahoo.com>
+ */
+
+#ifndef TPA_SEQ_INDEX_H
+#define TPA_SEQ_INDEX_H
+
+#include <stdint.h>
+#include <cstddef>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief Maps packet sequence numbers to record indexes
+ *
+ * Used to match received packets with the sent ones in a single pass.
+ * The sequence numbers of the SeqTsHeader and of the ICMPv6 echo are dense,
+ * so the index is normally a flat array addressed by (seq - minimum seq).
+ * When the numbers are too sparse for that (range much bigger than the
+ * number of packets) an open-addressing hash table with linear probing
+ * is used instead.
+ *
+ * The keys are 64 bit so that the flow can be put in the upper 32 bits
+ * (see MakeKey); with a single flow the keys stay dense.
+ */
+class TpaSeqIndex
+{
+public:
+  /// Returned by Find and Take when the sequence number is not in the index
+  static const uint32_t NOT_FOUND = 0xffffffff;
+
+  TpaSeqIndex ();
+
+  /**
+   * \return the key of sequence number seq in flow number flow
+   */
+  static uint64_t MakeKey (uint32_t flow, uint32_t seq);
+
+  /**
+   * Prepare the index for a set of sequence numbers; drops the old content
+   * \param minSeq the smallest key that will be inserted
+   * \param maxSeq the biggest key that will be inserted
+   * \param count the number of keys that will be inserted
+   */
+  void Prepare (uint64_t minSeq, uint64_t maxSeq, std::size_t count);
+  /**
+   * \param seq the sequence number
+   * \param value the record index stored for it
+   * \return false if the sequence number is already present, the first value is kept
+   */
+  bool Insert (uint64_t seq, uint32_t value);
+  /**
+   * \return the value stored for seq, or NOT_FOUND
+   */
+  uint32_t Find (uint64_t seq) const;
+  /**
+   * Same as Find, but the sequence number is marked as taken
+   * so the next lookups of it return NOT_FOUND (used for duplicates)
+   */
+  uint32_t Take (uint64_t seq);
+  /**
+   * \return true if the flat array is used, false for the hash table
+   */
+  bool IsFlat (void) const;
+  void Clear (void);
+
+private:
+  static const uint32_t TAKEN = 0xfffffffe;
+  uint32_t * Lookup (uint64_t seq);
+  static uint32_t Hash (uint64_t seq);
+
+  bool m_flat;
+  uint64_t m_base;                // smallest key, flat mode
+  std::vector<uint32_t> m_values; // flat mode: indexed by seq - m_base
+  std::vector<uint64_t> m_keys;   // hash mode only
+  std::vector<bool> m_used;       // hash mode only
+  uint32_t m_mask;                // hash mode: capacity - 1
+};
+
+} // namespace ns3
+
+#endif /* TPA_SEQ_INDEX_H */
@@ -0,0 +1,115 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Goran Shekerov <g_sekerov@yahoo.com>
+ */
+
+
+#include "tpa-seq-window.h"
+#include "ns3/assert.h"
+
+namespace ns3 {
+
+TpaSeqWindow::TpaSeqWindow ()
+  : m_mask (0),
+    m_inFlight (0)
+{
+  SetSize (4096);
+}
+
+TpaSeqWindow::TpaSeqWindow (uint32_t size)
+  : m_mask (0),
+    m_inFlight (0)
+{
+  SetSize (size);
+}
+
+void
+TpaSeqWindow::SetSize (uint32_t size)
+{
+  m_inFlight = 0;
+  if (size == 0)
+    {
+      m_slots.clear ();
+      m_mask = 0;
+      return;
+    }
+  uint32_t slots = 1;
+  while (slots < size)
+    {
+      slots = slots * 2;
+    }
+  m_mask = slots - 1;
+  Slot empty = { 0, 0, false };
+  m_slots.assign (slots, empty);
+}
+
+uint32_t
+TpaSeqWindow::GetSize (void) const
+{
+  return m_slots.size ();
+}
+
+bool
+TpaSeqWindow::Insert (uint32_t seq, int64_t sentTime)
+{
+  NS_ASSERT_MSG (!m_slots.empty (), "TpaSeqWindow used before SetSize");
+  Slot &slot = m_slots[seq & m_mask];
+  bool evicted = slot.inFlight;
+  if (!evicted)
+    {
+      m_inFlight = m_inFlight + 1;
+    }
+  slot.seq = seq;
+  slot.sentTime = sentTime;
+  slot.inFlight = true;
+  return evicted;
+}
+
+bool
+TpaSeqWindow::Take (uint32_t seq, int64_t &sentTime)
+{
+  if (m_slots.empty ())
+    {
+      return false;
+    }
+  Slot &slot = m_slots[seq & m_mask];
+  if (!slot.inFlight || slot.seq != seq)
+    {
+      return false;
+    }
+  sentTime = slot.sentTime;
+  slot.inFlight = false;
+  m_inFlight = m_inFlight - 1;
+  return true;
+}
+
+uint32_t
+TpaSeqWindow::GetInFlight (void) const
+{
+  return m_inFlight;
+}
+
+void
+TpaSeqWindow::Clear (void)
+{
+  for (uint32_t i = 0; i < m_slots.size (); i++)
+    {
+      m_slots[i].inFlight = false;
+    }
+  m_inFlight = 0;
+}
+
+} // namespace ns3
@@ -0,0 +1,85 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Goran Shekerov <g_sekerov@yahoo.com>
+ */
+
+
+#ifndef TPA_SEQ_WINDOW_H
+#define TPA_SEQ_WINDOW_H
+
+#include <stdint.h>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief Sent times of the packets still in flight
+ *
+ * Ring of slots addressed by (sequence number mod window size).  A sent
+ * packet stays in its slot until it is received or until a packet sent
+ * "window size" sequence numbers later takes the slot, so the memory is
+ * bounded by the window and not by the number of packets.
+ */
+class TpaSeqWindow
+{
+public:
+  TpaSeqWindow ();
+  /**
+   * \param size number of slots, rounded up to a power of two;
+   *        0 allocates nothing until SetSize is called
+   */
+  TpaSeqWindow (uint32_t size);
+
+  /**
+   * Resize the window; the content is dropped
+   * \param size number of slots, rounded up to a power of two; 0 frees the slots
+   */
+  void SetSize (uint32_t size);
+  uint32_t GetSize (void) const;
+
+  /**
+   * \param seq sequence number of the sent packet
+   * \param sentTime the time the packet was sent [ns]
+   * \return true if an older packet that was still in flight had to be evicted
+   */
+  bool Insert (uint32_t seq, int64_t sentTime);
+  /**
+   * \param seq sequence number of the received packet
+   * \param sentTime set to the time the packet was sent [ns]
+   * \return true if the packet was in flight; it is removed from the window
+   */
+  bool Take (uint32_t seq, int64_t &sentTime);
+
+  /// \return number of packets sent and not yet received
+  uint32_t GetInFlight (void) const;
+  void Clear (void);
+
+private:
+  struct Slot
+  {
+    int64_t  sentTime;
+    uint32_t seq;
+    bool     inFlight;
+  };
+
+  std::vector<Slot> m_slots;
+  uint32_t m_mask;
+  uint32_t m_inFlight;
+};
+
+} // namespace ns3
+
+#endif /* TPA_SEQ_WINDOW_H */
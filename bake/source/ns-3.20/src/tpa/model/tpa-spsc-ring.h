@@ -0,0 +1,144 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Goran Shekerov <g_sekerov@yahoo.com>
+ */
+
+
+#ifndef TPA_SPSC_RING_H
+#define TPA_SPSC_RING_H
+
+#include <stdint.h>
+
+namespace ns3 {
+
+/**
+ * \brief Lock-free single-producer / single-consumer ring of fixed capacity
+ *
+ * One thread calls TryPush, one other thread calls TryPop, without locks:
+ * each index is written by one side only, with a release store after the
+ * slot access, and read by the other side with an acquire load before it
+ * (GCC __atomic builtins, available in C++98 mode).
+ * The indexes are free running and kept on separate cache lines so the
+ * two threads don't share a line on every operation.
+ *
+ * T is expected to be a small plain struct.
+ */
+template <typename T>
+class TpaSpscRing
+{
+public:
+  /**
+   * \param capacity number of slots, rounded up to a power of two
+   */
+  explicit TpaSpscRing (uint32_t capacity);
+  ~TpaSpscRing ();
+
+  /**
+   * Producer side
+   * \return false if the ring is full, the item is not added
+   */
+  bool TryPush (const T &item);
+  /**
+   * Consumer side
+   * \return false if the ring is empty
+   */
+  bool TryPop (T &item);
+
+  uint32_t GetCapacity (void) const;
+  /// \return the number of items in the ring, exact only from one of the two threads
+  uint32_t GetSize (void) const;
+
+private:
+  // not copyable
+  TpaSpscRing (const TpaSpscRing &);
+  TpaSpscRing & operator= (const TpaSpscRing &);
+
+  T        *m_items;
+  uint32_t  m_mask;
+  char      m_pad0[64];
+  volatile uint32_t m_head;   // next slot to write, producer only
+  char      m_pad1[64];
+  volatile uint32_t m_tail;   // next slot to read, consumer only
+  char      m_pad2[64];
+};
+
+template <typename T>
+TpaSpscRing<T>::TpaSpscRing (uint32_t capacity)
+  : m_head (0),
+    m_tail (0)
+{
+  uint32_t size = 1;
+  while (size < capacity)
+    {
+      size = size * 2;
+    }
+  m_items = new T[size];
+  m_mask = size - 1;
+}
+
+template <typename T>
+TpaSpscRing<T>::~TpaSpscRing ()
+{
+  delete [] m_items;
+}
+
+template <typename T>
+inline bool
+TpaSpscRing<T>::TryPush (const T &item)
+{
+  uint32_t head = m_head;
+  uint32_t tail = __atomic_load_n (&m_tail, __ATOMIC_ACQUIRE); // the consumer is done with the slot
+  if (head - tail > m_mask)
+    {
+      return false;
+    }
+  m_items[head & m_mask] = item;
+  __atomic_store_n (&m_head, head + 1, __ATOMIC_RELEASE);     // publish the slot
+  return true;
+}
+
+template <typename T>
+inline bool
+TpaSpscRing<T>::TryPop (T &item)
+{
+  uint32_t tail = m_tail;
+  uint32_t head = __atomic_load_n (&m_head, __ATOMIC_ACQUIRE); // the slot is published
+  if (head == tail)
+    {
+      return false;
+    }
+  item = m_items[tail & m_mask];
+  __atomic_store_n (&m_tail, tail + 1, __ATOMIC_RELEASE);     // give the slot back
+  return true;
+}
+
+template <typename T>
+uint32_t
+TpaSpscRing<T>::GetCapacity (void) const
+{
+  return m_mask + 1;
+}
+
+template <typename T>
+uint32_t
+TpaSpscRing<T>::GetSize (void) const
+{
+  return __atomic_load_n (&m_head, __ATOMIC_ACQUIRE) - __atomic_load_n (&m_tail, __ATOMIC_ACQUIRE);
+}
+
+} // namespace ns3
+
+#endif /* TPA_SPSC_RING_H */
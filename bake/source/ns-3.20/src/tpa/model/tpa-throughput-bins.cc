@@ -0,0 +1,225 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Goran Shekerov <g_sekerov@yahoo.com>
+ */
+
+
+#include "tpa-throughput-bins.h"
+#include <cstdlib>
+#include <iomanip>
+#include <sstream>
+
+namespace ns3 {
+
+TpaThroughputBins::TpaThroughputBins ()
+  : m_maxBins (0)
+{
+}
+
+TpaThroughputBins::~TpaThroughputBins ()
+{
+  CloseFiles ();
+}
+
+void
+TpaThroughputBins::SetBinWidths (const std::vector<double> &widths)
+{
+  m_widths = widths;
+  Clear ();
+}
+
+bool
+TpaThroughputBins::ParseBinWidths (const std::string &list, std::vector<double> &widths)
+{
+  widths.clear ();
+  std::istringstream is (list);
+  std::string item;
+  while (std::getline (is, item, ','))
+    {
+      char *end;
+      double width = std::strtod (item.c_str (), &end);
+      if (end == item.c_str () || *end != '\0' || !(width > 0.0))
+        {
+          widths.clear ();
+          return false;
+        }
+      widths.push_back (width);
+    }
+  return !widths.empty ();
+}
+
+void
+TpaThroughputBins::SetMaxBins (uint32_t bins)
+{
+  m_maxBins = bins;
+  Clear ();
+}
+
+void
+TpaThroughputBins::Add (double time, uint32_t bytes)
+{
+  if (time < 0.0)
+    {
+      return;
+    }
+  for (uint32_t r = 0; r < m_widths.size (); r++)
+    {
+      std::deque<Bin> &bins = m_bins[r];
+      uint32_t bin = uint32_t (time / m_widths[r]);
+      bin = bin < m_firstBins[r] ? m_firstBins[r] : bin;
+      Bin empty = { 0, 0 };
+      while (m_maxBins > 0 && bin - m_firstBins[r] >= m_maxBins)
+        {
+          // the bins before the newest m_maxBins, empty ones too, one by one
+          if (bins.empty ())
+            {
+              bins.push_back (empty);
+            }
+          WriteOut (r);
+        }
+      if (bin - m_firstBins[r] >= bins.size ())
+        {
+          bins.resize (bin - m_firstBins[r] + 1, empty);
+        }
+      Bin &b = bins[bin - m_firstBins[r]];
+      b.packets = b.packets + 1;
+      b.bytes = b.bytes + bytes;
+    }
+}
+
+uint32_t
+TpaThroughputBins::GetNResolutions (void) const
+{
+  return m_widths.size ();
+}
+
+double
+TpaThroughputBins::GetBinWidth (uint32_t resolution) const
+{
+  return m_widths[resolution];
+}
+
+uint32_t
+TpaThroughputBins::GetNBins (uint32_t resolution) const
+{
+  return m_firstBins[resolution] + m_bins[resolution].size ();
+}
+
+uint32_t
+TpaThroughputBins::GetFirstBin (uint32_t resolution) const
+{
+  return m_firstBins[resolution];
+}
+
+uint32_t
+TpaThroughputBins::GetPackets (uint32_t resolution, uint32_t bin) const
+{
+  return m_bins[resolution][bin - m_firstBins[resolution]].packets;
+}
+
+uint64_t
+TpaThroughputBins::GetBytes (uint32_t resolution, uint32_t bin) const
+{
+  return m_bins[resolution][bin - m_firstBins[resolution]].bytes;
+}
+
+double
+TpaThroughputBins::GetThroughput (uint32_t resolution, uint32_t bin) const
+{
+  return (GetBytes (resolution, bin) * 8 / 1024.0) / (m_widths[resolution] / 1000); // [Kbps]
+}
+
+void
+TpaThroughputBins::Print (std::ostream &os) const
+{
+  for (uint32_t r = 0; r < m_widths.size (); r++)
+    {
+      if (r > 0)
+        {
+          os << std::endl << std::endl;
+        }
+      os.unsetf (std::ios_base::floatfield);
+      os << std::setprecision (6) << "#Bin_width " << m_widths[r] << " ms" << std::endl;
+      os << "#Time[s]    Throughput[Kbps]    Packets    Bytes" << std::endl;
+      if (m_files[r] != 0)
+        {
+          char buffer[4096];
+          std::rewind (m_files[r]);
+          for (std::size_t n; (n = std::fread (buffer, 1, sizeof (buffer), m_files[r])) > 0; )
+            {
+              os.write (buffer, n);
+            }
+        }
+      for (uint32_t i = 0; i < m_bins[r].size (); i++)
+        {
+          PrintBin (os, r, m_firstBins[r] + i, m_bins[r][i]);
+        }
+    }
+}
+
+void
+TpaThroughputBins::Clear (void)
+{
+  CloseFiles ();
+  m_bins.assign (m_widths.size (), std::deque<Bin> ());
+  m_firstBins.assign (m_widths.size (), 0);
+  m_files.assign (m_widths.size (), static_cast<std::FILE *> (0));
+}
+
+void
+TpaThroughputBins::PrintBin (std::ostream &os, uint32_t resolution, uint32_t bin, const Bin &b) const
+{
+  os << std::fixed << std::setprecision (3) << (bin + 1) * m_widths[resolution] / 1000;
+  os << "    " << std::setprecision (2) << (b.bytes * 8 / 1024.0) / (m_widths[resolution] / 1000);
+  os << "    " << b.packets;
+  os << "    " << b.bytes << std::endl;
+}
+
+void
+TpaThroughputBins::WriteOut (uint32_t resolution)
+{
+  std::deque<Bin> &bins = m_bins[resolution];
+  if (m_files[resolution] == 0)
+    {
+      m_files[resolution] = std::tmpfile ();
+      if (m_files[resolution] == 0)
+        {
+          m_maxBins = 0;                          // no temporary file: keep them all
+          return;
+        }
+    }
+  std::ostringstream line;
+  PrintBin (line, resolution, m_firstBins[resolution], bins.front ());
+  std::fseek (m_files[resolution], 0, SEEK_END);  // Print reads the file
+  std::fputs (line.str ().c_str (), m_files[resolution]);
+  bins.pop_front ();
+  m_firstBins[resolution]++;
+}
+
+void
+TpaThroughputBins::CloseFiles (void)
+{
+  for (uint32_t r = 0; r < m_files.size (); r++)
+    {
+      if (m_files[r] != 0)
+        {
+          std::fclose (m_files[r]);
+        }
+    }
+  m_files.clear ();
+}
+
+} // namespace ns3
@@ -0,0 +1,119 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Goran Shekerov <g_sekerov@yahoo.com>
+ */
+
+
+#ifndef TPA_THROUGHPUT_BINS_H
+#define TPA_THROUGHPUT_BINS_H
+
+#include <stdint.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <deque>
+#include <iostream>
+
+namespace ns3 {
+
+/**
+ * \brief Throughput time series at several bin widths at once
+ *
+ * Every received packet is added once and counted in the bin of each
+ * resolution it falls into (bin = time / width, time measured from the
+ * start of the simulation), so the series of all the resolutions are built
+ * in a single pass, whatever the order of the calls to Print.  Empty bins
+ * are kept: a handover shows up as bins with no packets.
+ *
+ * With SetMaxBins, only the newest bins of a resolution are kept in memory:
+ * the older ones are written, as Print lines, to an anonymous temporary
+ * file that Print copies back, so the memory doesn't grow with the run.
+ */
+class TpaThroughputBins
+{
+public:
+  TpaThroughputBins ();
+  ~TpaThroughputBins ();
+
+  /**
+   * \param widths bin widths [ms]; drops the packets already added
+   */
+  void SetBinWidths (const std::vector<double> &widths);
+  /**
+   * Parse a comma separated list of bin widths [ms], e.g. "10,100,1000"
+   * \return false if the list is empty or a width is not a positive number
+   */
+  static bool ParseBinWidths (const std::string &list, std::vector<double> &widths);
+  /**
+   * \param bins bins of every resolution kept in memory, 0 (default) for all;
+   *        drops the packets already added
+   */
+  void SetMaxBins (uint32_t bins);
+
+  /**
+   * \param time receive time [ms]; in the order of the receive times, a
+   *        packet of a bin already written out is counted in the oldest bin kept
+   * \param bytes packet size
+   */
+  void Add (double time, uint32_t bytes);
+
+  uint32_t GetNResolutions (void) const;
+  double GetBinWidth (uint32_t resolution) const;
+  /// \return the number of bins, written out or kept
+  uint32_t GetNBins (uint32_t resolution) const;
+  /// \return the first bin kept in memory; the Get functions of a bin need bin >= GetFirstBin
+  uint32_t GetFirstBin (uint32_t resolution) const;
+  uint32_t GetPackets (uint32_t resolution, uint32_t bin) const;
+  uint64_t GetBytes (uint32_t resolution, uint32_t bin) const;
+  /// \return throughput of the bin [Kbps]
+  double GetThroughput (uint32_t resolution, uint32_t bin) const;
+
+  /**
+   * Write one block per resolution, blocks separated by two empty lines
+   * (gnuplot index), lines "bin end [s]  throughput [Kbps]  packets  bytes"
+   */
+  void Print (std::ostream &os) const;
+  /**
+   * Forget the packets, keep the bin widths
+   */
+  void Clear (void);
+
+private:
+  struct Bin
+  {
+    uint32_t packets;
+    uint64_t bytes;
+  };
+
+  // not copyable, the temporary files are owned
+  TpaThroughputBins (const TpaThroughputBins &);
+  TpaThroughputBins & operator= (const TpaThroughputBins &);
+
+  void PrintBin (std::ostream &os, uint32_t resolution, uint32_t bin, const Bin &b) const;
+  /// write the oldest bin kept of resolution to its temporary file
+  void WriteOut (uint32_t resolution);
+  void CloseFiles (void);
+
+  std::vector<double> m_widths;             // [ms]
+  std::vector<std::deque<Bin> > m_bins;     // one series per width, the bins kept
+  std::vector<uint32_t> m_firstBins;        // bin of m_bins[r][0]
+  std::vector<std::FILE *> m_files;         // bins written out, 0 until the first
+  uint32_t m_maxBins;                       // 0 for all
+};
+
+} // namespace ns3
+
+#endif /* TPA_THROUGHPUT_BINS_H */
@@ -0,0 +1,51 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Goran Shekerov <g_sekerov@yahoo.com>
+ */
+
+#ifndef TPA_TIME_H
+#define TPA_TIME_H
+
+#include <stdint.h>
+
+namespace ns3 {
+
+/**
+ * Tpa carries the times of the packets as int64_t nanoseconds, the
+ * resolution of the simulator (Time::GetNanoSeconds), so delays and
+ * jitter are exact integer differences and their sums exact integer
+ * sums.  They are converted to double milliseconds, the unit of the
+ * results, only for the statistics that are printed.
+ */
+static const int64_t TPA_NS_PER_MS = 1000000;
+
+/// \return the time in [ms]
+inline double
+TpaNsToMs (int64_t ns)
+{
+  return ns / double (TPA_NS_PER_MS);
+}
+
+/// \return the time in [ns], rounded to the nearest ns
+inline int64_t
+TpaMsToNs (double ms)
+{
+  return int64_t (ms * TPA_NS_PER_MS + (ms < 0 ? -0.5 : 0.5));
+}
+
+} // namespace ns3
+
+#endif /* TPA_TIME_H */
@@ -0,0 +1,187 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Goran Shekerov <g_sekerov@yahoo.com>
+ */
+
+#ifndef TPA_TRAFFIC_PARSER_H
+#define TPA_TRAFFIC_PARSER_H
+
+#include "ns3/packet.h"
+#include "ns3/icmpv6-header.h"
+#include "tpa-packet-view.h"
+#include "tpa-ipv6-walker.h"
+#include "tpa-flow-table.h"
+#include <cstring>
+
+namespace ns3 {
+
+/**
+ * \brief Fields of an application packet read by a traffic parser
+ */
+struct TpaParsedPacket
+{
+  uint32_t   seq;
+  uint32_t   size;   //!< bytes counted in the throughput
+  uint8_t    path;   //!< TpaPathFlag bits
+  TpaFlowKey key;
+};
+
+/**
+ * \brief Parser policies of the Tpa traffic types
+ *
+ * Every traffic type has a policy with three static functions, all
+ * inline so they are compiled into the loader Tpa instantiates for it
+ * (Tpa::LoadSent<Parser>, Tpa::LoadReceived<Parser>):
+ *  - Accept: cheap filter on the packet, before its bytes are copied;
+ *  - ParseSent / ParseReceived: sequence number, size, path and flow of
+ *    a packet seen by the sender / receiver sink, false if it isn't one
+ *    of the application.
+ *
+ * A new traffic type (e.g. TCP) is a new policy and one case in
+ * Tpa::SetTrafficType; no per-packet switch.
+ */
+struct TpaTrafficParser
+{
+  enum
+  {
+    UDP_HEADER_SIZE = 8,
+    SEQ_SIZE = 4,                   //!< SeqTsHeader: 4 bytes sequence number, then 8 bytes time stamp
+    ICMPV6_ECHO_SIZE = 8,           //!< type, code, checksum, identifier, sequence number
+    ICMPV6_ECHO_SEQ_OFFSET = 6,
+    IPV6_SOURCE_OFFSET = 8,
+    IPV6_DESTINATION_OFFSET = 24
+  };
+
+  static bool Accept (const Ptr<const Packet> &packet)
+  {
+    return true;
+  }
+
+  /// Home addresses when the packet is route optimized, inner-most addresses otherwise
+  static void ReadFlowKey (const TpaPacketView &view, const TpaIpv6Path &ipv6Path, TpaFlowKey &key)
+  {
+    uint32_t ipv6 = ipv6Path.ipv6Offset;
+    key.protocol = ipv6Path.protocol;
+    key.flowLabel = view.ReadNtohU32 (ipv6) & 0xfffff;
+    std::memcpy (key.source, view.PeekData (ipv6Path.haoOffset ? ipv6Path.haoOffset : ipv6 + IPV6_SOURCE_OFFSET), 16);
+    std::memcpy (key.destination, view.PeekData (ipv6Path.rh2Offset ? ipv6Path.rh2Offset : ipv6 + IPV6_DESTINATION_OFFSET), 16);
+  }
+
+  /// UDP packet with a SeqTsHeader, after any link layer and any chain of tunnel / RO extension headers
+  static bool ReadUdpSeq (const TpaPacketView &view, TpaParsedPacket &packet)
+  {
+    uint32_t ipv6Offset;
+    TpaIpv6Path ipv6Path;
+    if (!TpaIpv6Walker::FindIpv6Header (view, ipv6Offset)
+        || !TpaIpv6Walker::Walk (view, ipv6Offset, ipv6Path) || ipv6Path.protocol != 17) // UDP
+      {
+        return false;
+      }
+    uint32_t offset = ipv6Path.offset + UDP_HEADER_SIZE;
+    if (!view.Has (offset, SEQ_SIZE))
+      {
+        return false;
+      }
+    packet.seq = view.ReadNtohU32 (offset);
+    packet.path = ipv6Path.flags;
+    ReadFlowKey (view, ipv6Path, packet.key);
+    packet.key.sourcePort = view.ReadNtohU16 (ipv6Path.offset);
+    packet.key.destinationPort = view.ReadNtohU16 (ipv6Path.offset + 2);
+    return true;
+  }
+
+  /// ICMPv6 echo request or reply; requests and replies are put in the same flow
+  static bool ReadEchoSeq (const TpaPacketView &view, uint8_t type, TpaParsedPacket &packet)
+  {
+    uint32_t ipv6Offset;
+    TpaIpv6Path ipv6Path;
+    if (!TpaIpv6Walker::FindIpv6Header (view, ipv6Offset)
+        || !TpaIpv6Walker::Walk (view, ipv6Offset, ipv6Path) || ipv6Path.protocol != 58) // ICMPv6
+      {
+        return false;
+      }
+    if (!view.Has (ipv6Path.offset, ICMPV6_ECHO_SIZE) || view.ReadU8 (ipv6Path.offset) != type)
+      {
+        return false;
+      }
+    packet.seq = view.ReadNtohU16 (ipv6Path.offset + ICMPV6_ECHO_SEQ_OFFSET);
+    packet.path = ipv6Path.flags;
+    TpaFlowKey &key = packet.key;
+    ReadFlowKey (view, ipv6Path, key);
+    if (std::memcmp (key.source, key.destination, 16) > 0)
+      {
+        uint8_t address[16];
+        std::memcpy (address, key.source, 16);
+        std::memcpy (key.source, key.destination, 16);
+        std::memcpy (key.destination, address, 16);
+      }
+    return true;
+  }
+};
+
+/**
+ * \brief PING: echo requests sent by the MN, echo replies back to it (RTT)
+ */
+struct TpaEchoParser : public TpaTrafficParser
+{
+  static bool ParseSent (const TpaPacketView &view, TpaParsedPacket &packet)
+  {
+    packet.size = view.GetPacketSize ();
+    return ReadEchoSeq (view, Icmpv6Header::ICMPV6_ECHO_REQUEST, packet);
+  }
+
+  static bool ParseReceived (const TpaPacketView &view, TpaParsedPacket &packet)
+  {
+    packet.size = 0;
+    return ReadEchoSeq (view, Icmpv6Header::ICMPV6_ECHO_REPLY, packet);
+  }
+};
+
+/**
+ * \brief VIDEO_S: UdpTraceClient packets
+ */
+struct TpaUdpTraceParser : public TpaTrafficParser
+{
+  static bool ParseSent (const TpaPacketView &view, TpaParsedPacket &packet)
+  {
+    packet.size = view.GetPacketSize ();
+    return ReadUdpSeq (view, packet);
+  }
+
+  static bool ParseReceived (const TpaPacketView &view, TpaParsedPacket &packet)
+  {
+    // the Wifi header (802.11 data + LLC) = 32 bytes are removed before the sink
+    packet.size = view.GetPacketSize () + 32;
+    return ReadUdpSeq (view, packet);
+  }
+};
+
+/**
+ * \brief UDPCBR and VOIP: OnOff application packets
+ */
+struct TpaOnOffParser : public TpaUdpTraceParser
+{
+  static bool Accept (const Ptr<const Packet> &packet)
+  {
+    // filter OnOff packets from the rest (80 IP6-IP6 + 8 UDP + 172 VoIP payload = 260 bytes),
+    // all other control packets are less than 200 bytes
+    return packet->GetSize () > 200;
+  }
+};
+
+} // namespace ns3
+
+#endif /* TPA_TRAFFIC_PARSER_H */
@@ -0,0 +1,374 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Goran Shekerov <g_sekerov@yahoo.com>
+ */
+
+#include "tpa-video-trace.h"
+#include "ns3/assert.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace ns3 {
+
+namespace {
+
+bool
+IsSpace (char c)
+{
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+bool
+IsDigit (char c)
+{
+  return c >= '0' && c <= '9';
+}
+
+// skip the blanks of the line, then read an unsigned number
+bool
+ReadNumber (const char *&p, const char *end, uint32_t &value)
+{
+  while (p < end && IsSpace (*p))
+    {
+      p++;
+    }
+  if (p == end || !IsDigit (*p))
+    {
+      return false;
+    }
+  value = 0;
+  while (p < end && IsDigit (*p))
+    {
+      value = value * 10 + (*p - '0');
+      p++;
+    }
+  return true;
+}
+
+} // anonymous namespace
+
+TpaVideoTrace::TpaVideoTrace ()
+  : m_frameRate (0.0)
+{
+}
+
+TpaVideoTrace::~TpaVideoTrace ()
+{
+}
+
+bool
+TpaVideoTrace::Open (const std::string &fileName, uint32_t maxPacketSize)
+{
+  Close ();
+  int fd = open (fileName.c_str (), O_RDONLY);
+  if (fd < 0)
+    {
+      return false;
+    }
+  struct stat st;
+  if (fstat (fd, &st) != 0 || st.st_size == 0)
+    {
+      close (fd);
+      return false;
+    }
+  void *text = mmap (0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close (fd);
+  if (text == MAP_FAILED)
+    {
+      return false;
+    }
+  bool ok = Parse (static_cast<const char *> (text), st.st_size, maxPacketSize);
+  munmap (text, st.st_size);
+  return ok;
+}
+
+bool
+TpaVideoTrace::Parse (const char *text, std::size_t length, uint32_t maxPacketSize)
+{
+  Close ();
+  if (maxPacketSize == 0)
+    {
+      return false;
+    }
+  const char *p = text;
+  const char *end = text + length;
+  uint32_t seq = 0;
+  uint32_t minTime = 0xffffffff;
+  uint32_t maxTime = 0;
+  while (p < end)
+    {
+      const char *eol = p;
+      while (eol < end && *eol != '\n')
+        {
+          eol++;
+        }
+      uint32_t number;
+      if (ReadNumber (p, eol, number))   // other lines (empty, comments) are skipped
+        {
+          while (p < eol && IsSpace (*p))
+            {
+              p++;
+            }
+          TpaVideoFrame frame;
+          switch (p < eol ? *p++ : 0)
+            {
+            case 'I': frame.type = TpaVideoFrame::I; break;
+            case 'P': frame.type = TpaVideoFrame::P; break;
+            case 'B': frame.type = TpaVideoFrame::B; break;
+            default:
+              Close ();
+              return false;
+            }
+          if (!ReadNumber (p, eol, frame.time) || !ReadNumber (p, eol, frame.size))
+            {
+              Close ();
+              return false;
+            }
+          frame.firstSeq = seq;
+          frame.packets = frame.size / maxPacketSize + 1;   // the last packet is always sent, even empty
+          seq = seq + frame.packets;
+          m_seqToFrame.insert (m_seqToFrame.end (), frame.packets, m_frames.size ());
+          m_frames.push_back (frame);
+          minTime = frame.time < minTime ? frame.time : minTime;
+          maxTime = frame.time > maxTime ? frame.time : maxTime;
+        }
+      p = eol + 1;
+    }
+  if (m_frames.size () > 1 && maxTime > minTime)
+    {
+      m_frameRate = (m_frames.size () - 1) * 1000.0 / (maxTime - minTime);
+    }
+  return !m_frames.empty ();
+}
+
+bool
+TpaVideoTrace::IsOpen (void) const
+{
+  return !m_frames.empty ();
+}
+
+void
+TpaVideoTrace::Close (void)
+{
+  m_frames.clear ();
+  m_seqToFrame.clear ();
+  m_frameRate = 0.0;
+}
+
+uint32_t
+TpaVideoTrace::GetNFrames (void) const
+{
+  return m_frames.size ();
+}
+
+uint32_t
+TpaVideoTrace::GetNPackets (void) const
+{
+  return m_seqToFrame.size ();
+}
+
+const TpaVideoFrame &
+TpaVideoTrace::GetFrame (uint32_t frame) const
+{
+  return m_frames[frame];
+}
+
+double
+TpaVideoTrace::GetFrameRate (void) const
+{
+  return m_frameRate;
+}
+
+uint32_t
+TpaVideoTrace::FindFrame (uint32_t seq) const
+{
+  NS_ASSERT_MSG (IsOpen (), "TpaVideoTrace used before Open");
+  uint32_t packets = m_seqToFrame.size ();
+  return seq / packets * m_frames.size () + m_seqToFrame[seq % packets];
+}
+
+TpaVideoQuality::TpaVideoQuality ()
+  : decodable (0),
+    q (0.0),
+    fps (0.0),
+    psnr (0.0),
+    mos (0.0)
+{
+  for (int i = 0; i < 3; i++)
+    {
+      sent[i] = 0;
+      lost[i] = 0;
+    }
+}
+
+double
+TpaVideoQuality::GetLoss (uint8_t type) const
+{
+  return sent[type] > 0 ? lost[type] * 100.0 / sent[type] : 0.0;
+}
+
+uint32_t
+TpaVideoQuality::GetSent (void) const
+{
+  return sent[TpaVideoFrame::I] + sent[TpaVideoFrame::P] + sent[TpaVideoFrame::B];
+}
+
+void
+TpaVideoQuality::Print (std::ostream &os, const char *separator) const
+{
+  os << separator << GetLoss (TpaVideoFrame::I);
+  os << separator << GetLoss (TpaVideoFrame::P);
+  os << separator << GetLoss (TpaVideoFrame::B);
+  os << separator << q * 100;
+  os << separator << fps;
+  os << separator << psnr;
+  os << separator << mos;
+}
+
+TpaVideoReassembler::TpaVideoReassembler ()
+  : m_trace (0),
+    m_nominalPsnr (36.0),
+    m_concealedPsnr (16.0)
+{
+  Clear ();
+}
+
+void
+TpaVideoReassembler::SetTrace (const TpaVideoTrace *trace)
+{
+  m_trace = trace;
+  Clear ();
+}
+
+void
+TpaVideoReassembler::SetPsnr (double nominal, double concealed)
+{
+  m_nominalPsnr = nominal;
+  m_concealedPsnr = concealed;
+}
+
+void
+TpaVideoReassembler::AddSent (uint32_t seq)
+{
+  uint32_t frame = m_trace->FindFrame (seq);
+  if (!m_sent || frame >= m_sentFrames)
+    {
+      m_sentFrames = frame + 1;
+    }
+  m_sent = true;
+}
+
+void
+TpaVideoReassembler::AddReceived (uint32_t seq)
+{
+  uint32_t frame = m_trace->FindFrame (seq);
+  if (frame >= m_received.size ())
+    {
+      m_received.resize (frame + 1, 0);
+    }
+  m_received[frame]++;
+}
+
+TpaVideoQuality
+TpaVideoReassembler::GetQuality (void) const
+{
+  TpaVideoQuality quality;
+  if (m_trace == 0 || !m_trace->IsOpen ())
+    {
+      return quality;
+    }
+  uint32_t frames = m_sentFrames > m_received.size () ? m_sentFrames : m_received.size ();
+  uint32_t nFrames = m_trace->GetNFrames ();
+  uint32_t refs = 0;           // I and P frames so far
+  bool lastRef = false;        // the last two of them decodable
+  bool previousRef = false;
+  double psnr = 0.0;
+  double mos = 0.0;
+  for (uint32_t f = 0; f < frames; f++)
+    {
+      const TpaVideoFrame &frame = m_trace->GetFrame (f % nFrames);
+      bool received = f < m_received.size () && m_received[f] >= frame.packets;
+      bool decodable = received;
+      quality.sent[frame.type]++;
+      if (!received)
+        {
+          quality.lost[frame.type]++;
+        }
+      if (frame.type == TpaVideoFrame::B)
+        {
+          decodable = decodable && lastRef && (refs < 2 || previousRef);
+        }
+      else
+        {
+          if (frame.type == TpaVideoFrame::P)
+            {
+              decodable = decodable && lastRef;
+            }
+          previousRef = lastRef;
+          lastRef = decodable;
+          refs = refs + 1;
+        }
+      if (decodable)
+        {
+          quality.decodable++;
+        }
+      double framePsnr = decodable ? m_nominalPsnr : m_concealedPsnr;
+      psnr = psnr + framePsnr;
+      mos = mos + GetMos (framePsnr);
+    }
+  if (frames > 0)
+    {
+      quality.q = quality.decodable / double (frames);
+      quality.fps = quality.q * m_trace->GetFrameRate ();
+      quality.psnr = psnr / frames;
+      quality.mos = mos / frames;
+    }
+  return quality;
+}
+
+double
+TpaVideoReassembler::GetMos (double psnr)
+{
+  if (psnr > 37)
+    {
+      return 5;
+    }
+  if (psnr > 31)
+    {
+      return 4;
+    }
+  if (psnr > 25)
+    {
+      return 3;
+    }
+  if (psnr > 20)
+    {
+      return 2;
+    }
+  return 1;
+}
+
+void
+TpaVideoReassembler::Clear (void)
+{
+  m_sent = false;
+  m_sentFrames = 0;
+  m_received.clear ();
+}
+
+} // namespace ns3
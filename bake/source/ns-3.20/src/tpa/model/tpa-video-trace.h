@@ -0,0 +1,175 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Goran Shekerov <g_sekerov@yahoo.com>
+ */
+
+#ifndef TPA_VIDEO_TRACE_H
+#define TPA_VIDEO_TRACE_H
+
+#include <stdint.h>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <iostream>
+
+namespace ns3 {
+
+/**
+ * \brief One frame of a video trace, in sending (decoding) order
+ */
+struct TpaVideoFrame
+{
+  enum Type
+  {
+    I = 0,
+    P = 1,
+    B = 2
+  };
+
+  uint32_t firstSeq;  //!< sequence number of its first packet, first cycle of the trace
+  uint32_t size;      //!< bytes
+  uint32_t time;      //!< display time [ms]
+  uint16_t packets;
+  uint8_t  type;      //!< Type
+};
+
+/**
+ * \brief Index of a video trace file of UdpTraceClient
+ *
+ * The trace (e.g. formula1_medium_quality.dat) has one line per frame,
+ * "frame-number type time size", the frames in decoding order, type I, P
+ * or B, the time in ms.  The file is mmap'ed and parsed in place once; the
+ * index keeps the frames and a table from packet sequence number to frame,
+ * so FindFrame is one array lookup per packet.
+ *
+ * The packets are numbered as UdpTraceClient sends them: every frame is
+ * cut in size / MaxPacketSize full packets and a last one with the rest,
+ * one sequence number (SeqTsHeader) per packet, the frames in the trace
+ * order, and the trace restarts at its first frame when it is over.
+ */
+class TpaVideoTrace
+{
+public:
+  TpaVideoTrace ();
+  ~TpaVideoTrace ();
+
+  /**
+   * \param fileName trace file
+   * \param maxPacketSize MaxPacketSize of the UdpTraceClient
+   * \return false if the file can't be mapped or isn't a video trace
+   */
+  bool Open (const std::string &fileName, uint32_t maxPacketSize);
+  /// Index the text of a trace; Open calls it on the mapped file
+  bool Parse (const char *text, std::size_t length, uint32_t maxPacketSize);
+  bool IsOpen (void) const;
+  void Close (void);
+
+  uint32_t GetNFrames (void) const;
+  /// \return the packets of one cycle of the trace
+  uint32_t GetNPackets (void) const;
+  const TpaVideoFrame & GetFrame (uint32_t frame) const;
+  /// \return the frames per second of the display times, 0 if unknown
+  double GetFrameRate (void) const;
+  /**
+   * \param seq packet sequence number
+   * \return the frame number counted from the start of the stream, the
+   *         cycles of the trace included: frame % GetNFrames () in the trace
+   */
+  uint32_t FindFrame (uint32_t seq) const;
+
+private:
+  std::vector<TpaVideoFrame> m_frames;
+  std::vector<uint32_t> m_seqToFrame;
+  double m_frameRate;
+};
+
+/**
+ * \brief Frame loss and decodability of a video stream
+ */
+struct TpaVideoQuality
+{
+  uint32_t sent[3];     //!< frames sent, by TpaVideoFrame::Type
+  uint32_t lost[3];     //!< frames with a packet lost, by type
+  uint32_t decodable;   //!< frames received and with their reference frames decodable
+  double   q;           //!< decodable frame ratio [0, 1]
+  double   fps;         //!< decodable frames per second
+  double   psnr;        //!< estimated mean PSNR [dB]
+  double   mos;         //!< mean of the per-frame MOS of the PSNR
+
+  TpaVideoQuality ();
+  /// \return frames of this type lost [%]
+  double GetLoss (uint8_t type) const;
+  uint32_t GetSent (void) const;
+  /**
+   * Write 7 fields, each preceded by separator:
+   * I, P and B frame loss [%], decodable frames [%], decodable fps, PSNR, MOS
+   */
+  void Print (std::ostream &os, const char *separator) const;
+};
+
+/**
+ * \brief Receive side frame reassembly of a UdpTraceClient video stream
+ *
+ * The packets received of every frame are counted (the duplicates must
+ * be filtered before AddReceived), a frame is received when all its
+ * packets are.  The sent frames are found from the highest sent sequence
+ * number.
+ *
+ * GetQuality walks the sent frames in decoding order and propagates the
+ * GOP dependencies: an I frame is decodable when it is received, a P frame
+ * when it is received and the previous I or P frame is decodable, a B
+ * frame when it is received and the two previous I or P frames (the ones
+ * it is displayed between) are decodable.
+ *
+ * The PSNR is not measured (there are no decoded pictures): every
+ * decodable frame is given the nominal PSNR of the encoding, every other
+ * frame, concealed by freezing the last decodable picture, the
+ * concealment PSNR (SetPsnr).  The MOS is the mean of the EvalVid mapping
+ * of the per-frame PSNR (> 37 dB: 5, > 31: 4, > 25: 3, > 20: 2, else 1).
+ *
+ * O(1) per packet, one counter per sent frame.
+ */
+class TpaVideoReassembler
+{
+public:
+  TpaVideoReassembler ();
+
+  /// \param trace index of the sent trace, kept by the caller
+  void SetTrace (const TpaVideoTrace *trace);
+  /**
+   * \param nominal PSNR of a decodable frame [dB], 36 by default
+   * \param concealed PSNR of a concealed frame [dB], 16 by default
+   */
+  void SetPsnr (double nominal, double concealed);
+  void AddSent (uint32_t seq);
+  void AddReceived (uint32_t seq);
+  TpaVideoQuality GetQuality (void) const;
+  /// \return the MOS of a PSNR [dB], EvalVid mapping
+  static double GetMos (double psnr);
+  void Clear (void);
+
+private:
+  const TpaVideoTrace *m_trace;
+  double m_nominalPsnr;
+  double m_concealedPsnr;
+  bool m_sent;
+  uint32_t m_sentFrames;             // frames whose first packet is sent
+  std::vector<uint16_t> m_received;  // packets received, by frame of the stream
+};
+
+} // namespace ns3
+
+#endif /* TPA_VIDEO_TRACE_H */
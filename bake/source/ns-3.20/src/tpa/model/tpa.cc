@@ -18,30 +18,172 @@
  */
 
 #include "tpa.h"
+#include "tpa-seq-index.h"
+#include "tpa-kernels.h"
+#include "ns3/boolean.h"
+#include "ns3/uinteger.h"
+#include "ns3/simulator.h"
+#include "ns3/string.h"
+#include "ns3/fatal-error.h"
+#include "ns3/log.h"
 #include <iomanip>  // this is needed for std::setprecision()
 #include <ns3/ethernet-header.h>
 #include <ns3/wifi-mac-header.h>
 #include <ns3/wifi-module.h>
 #include <ns3/llc-snap-header.h>
 #include <ns3/ipv6-header.h>
+#include <ns3/ipv6-address.h>
 #include <ns3/icmpv6-header.h>
 #include <ns3/udp-header.h>
 #include <iomanip>
 #include <math.h>
 #include <ns3/ipv6-extension-header.h>
 #include <fstream>
+#include <cstring>
 
+NS_LOG_COMPONENT_DEFINE ("Tpa");
 
 namespace ns3 {
 
 NS_OBJECT_ENSURE_REGISTERED (Tpa);
 
+// p50, p90, p95, p99, p99.9 and max, in this order in the result line
+static const double g_reportedQuantiles[6] = { 0.5, 0.9, 0.95, 0.99, 0.999, 1.0 };
+static const char *g_quantileNames[6] = { "p50", "p90", "p95", "p99", "p999", "max" };
+
+// the working directory; ns3ScriptRunner passes its own with --output_dir
+static const char *g_defaultOutputDirectory = ".";
+
 TypeId
 Tpa::GetTypeId (void)
 {
   static TypeId tid = TypeId ("ns3::Tpa")
     .SetParent<Object> ()
     .AddConstructor<Tpa> ()
+    .AddAttribute ("StreamingMode",
+                   "Update the statistics as the packets are loaded instead of "
+                   "keeping every packet until PrintTrafficPerformances; the memory "
+                   "is then per flow, per handover and per ThroughputBins width, not "
+                   "per packet (VIDEO_S still keeps a count per video frame). Set it "
+                   "before the traffic starts.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&Tpa::SetStreamingMode,
+                                        &Tpa::IsStreamingMode),
+                   MakeBooleanChecker ())
+    .AddAttribute ("InFlightWindow",
+                   "Streaming mode: number of sent packets of each flow whose send time "
+                   "is kept while waiting to be received (rounded up to a power of two).",
+                   UintegerValue (4096),
+                   MakeUintegerAccessor (&Tpa::SetInFlightWindow,
+                                         &Tpa::GetInFlightWindow),
+                   MakeUintegerChecker<uint32_t> (1, 0x1000000))
+    .AddAttribute ("ReorderWindow",
+                   "Sequence numbers of each flow remembered to detect reordered and "
+                   "duplicated packets (rounded up to a power of two).",
+                   UintegerValue (1024),
+                   MakeUintegerAccessor (&Tpa::SetReorderWindow,
+                                         &Tpa::GetReorderWindow),
+                   MakeUintegerChecker<uint32_t> (1, 0x1000000))
+    .AddAttribute ("LossGmin",
+                   "Received packets in a row that end a loss burst (RFC 3611 Gmin), "
+                   "for the Gilbert-Elliott loss model.  Set it before the traffic starts.",
+                   UintegerValue (16),
+                   MakeUintegerAccessor (&Tpa::SetLossGmin,
+                                         &Tpa::GetLossGmin),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("Codec",
+                   "Codec profile of the E-model R value and MOS: G.711, G.729 or G.722.",
+                   StringValue ("G.711"),
+                   MakeStringAccessor (&Tpa::SetCodec,
+                                       &Tpa::GetCodec),
+                   MakeStringChecker ())
+    .AddAttribute ("ReportInterval",
+                   "Interval of the periodic reports of throughput, loss, delay (mean, p99), "
+                   "jitter, R and MOS, appended to the report stream (tempseries.txt by "
+                   "default) while the simulation runs; 0 disables them.",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&Tpa::SetReportInterval,
+                                     &Tpa::GetReportInterval),
+                   MakeTimeChecker ())
+    .AddAttribute ("ThroughputBins",
+                   "Comma separated bin widths [ms] of the throughput series written "
+                   "by PrintThroughput (Throughput.txt), e.g. \"10,100,1000\".",
+                   StringValue ("1000"),
+                   MakeStringAccessor (&Tpa::SetThroughputBins,
+                                       &Tpa::GetThroughputBins),
+                   MakeStringChecker ())
+    .AddAttribute ("RecordQueue",
+                   "Capacity of the queue to the background thread writing the RecordFile; "
+                   "0 writes the records from the simulator thread.  Set it before RecordFile.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&Tpa::SetRecordQueue,
+                                         &Tpa::GetRecordQueue),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("RecordDropWhenFull",
+                   "Drop (and count) the records that find the RecordQueue full instead "
+                   "of waiting for the writer thread.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&Tpa::SetRecordDropWhenFull,
+                                        &Tpa::GetRecordDropWhenFull),
+                   MakeBooleanChecker ())
+    .AddAttribute ("RecordFile",
+                   "Binary columnar file of the per-packet records (TpaRecordWriter); "
+                   "empty disables it.",
+                   StringValue (""),
+                   MakeStringAccessor (&Tpa::SetRecordFile,
+                                       &Tpa::GetRecordFile),
+                   MakeStringChecker ())
+    .AddAttribute ("HandoverWindow",
+                   "Length of the windows before and after every handover in which "
+                   "the delay and jitter of its impact are averaged.",
+                   TimeValue (Seconds (1)),
+                   MakeTimeAccessor (&Tpa::SetHandoverWindow,
+                                     &Tpa::GetHandoverWindow),
+                   MakeTimeChecker ())
+    .AddAttribute ("HandoverMaxDuration",
+                   "Longest handover, from its start: one not finished by then "
+                   "(its BA lost) is taken to end there, so its impact is closed.",
+                   TimeValue (Seconds (10)),
+                   MakeTimeAccessor (&Tpa::SetHandoverMaxDuration,
+                                     &Tpa::GetHandoverMaxDuration),
+                   MakeTimeChecker ())
+    .AddAttribute ("LoadUntil",
+                   "The packets of the trace sinks (GetSentCallback, GetReceivedCallback) "
+                   "are ignored from this time on; 0 for never.",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&Tpa::SetLoadUntil,
+                                     &Tpa::GetLoadUntil),
+                   MakeTimeChecker ())
+    .AddAttribute ("VideoPacketSize",
+                   "MaxPacketSize of the UdpTraceClient, to cut the frames of the VideoTrace "
+                   "into packets.  Set it before VideoTrace.",
+                   UintegerValue (1412),
+                   MakeUintegerAccessor (&Tpa::SetVideoPacketSize,
+                                         &Tpa::GetVideoPacketSize),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("VideoTrace",
+                   "Video trace file of the UdpTraceClient (VIDEO_S): the received packets "
+                   "are reassembled into its frames (TpaVideoReassembler), the frame loss, "
+                   "decodability, PSNR and MOS written to tempvideo.txt.  Empty disables "
+                   "the frame analysis.",
+                   StringValue (""),
+                   MakeStringAccessor (&Tpa::SetVideoTrace,
+                                       &Tpa::GetVideoTrace),
+                   MakeStringChecker ())
+    .AddAttribute ("OutputDirectory",
+                   "Directory of the result files (tempresults.txt, results.json, ...); "
+                   "empty for the working directory.",
+                   StringValue (g_defaultOutputDirectory),
+                   MakeStringAccessor (&Tpa::SetOutputDirectory,
+                                       &Tpa::GetOutputDirectory),
+                   MakeStringChecker ())
+    .AddAttribute ("RunId",
+                   "Appended to the names of the result files (tempresults-<RunId>.txt, ...) "
+                   "so that concurrent runs don't share files; empty for none.",
+                   StringValue (""),
+                   MakeStringAccessor (&Tpa::SetRunId,
+                                       &Tpa::GetRunId),
+                   MakeStringChecker ())
     ;
   return tid;
 }
@@ -49,99 +191,556 @@ Tpa::GetTypeId (void)
 Tpa::Tpa ()
 {
   m_trafficType = 55;
+  SetUnknownParser ();
   m_receivedPacketSize = 0;
   m_sentPacketSize = 0;
   m_enable_column_labels = true;
-  m_next_sentPacketIndex = 0;
-  m_next_receivedPacketIndex = 0;
-  m_next_delayIndex = 0;
-  m_next_jitterIndex = 0;
+  m_streaming = false;
+  m_streamSent = 0;
+  m_streamReceived = 0;
+  m_streamEvicted = 0;
+  m_streamBytes = 0;
+  m_startTrafficTime = 0;
+  m_stopTrafficTime = 0;
+  m_delaySum = 0;
+  m_jitterSum = 0;
+  m_delays = 0;
+  m_jitters = 0;
+  m_sentPacketsNumber = 0;
+  m_receivedPacketsNumber = 0;
+  m_receivedBytes = 0;
+  m_calculated = false;
+  m_receivedDirect = 0;
+  m_receivedTunnel = 0;
+  m_receivedRo = 0;
+  m_reportHeader = false;
+  m_recordQueue = 0;
+  m_recordDropWhenFull = false;
+  m_videoPacketSize = 1412;
+  m_outputDirectory = g_defaultOutputDirectory;
+  ResetInterval ();
+  SetThroughputBins ("1000");
 }
 
 Tpa::~Tpa ()
 {
 }
 
+void
+Tpa::DoDispose (void)
+{
+  m_reportEvent.Cancel ();
+  m_reportStream = 0;
+  m_recordWriter.Close ();
+  // a TpaCollector keeps the results, the packets of a disposed Tpa are released
+  sentDataArray.sentTime.Clear ();
+  sentDataArray.key.Clear ();
+  receivedDataArray.receivedTime.Clear ();
+  receivedDataArray.key.Clear ();
+  receivedDataArray.packetSize.Clear ();
+  delaysTempArray.Clear ();
+  jitterTempArray.Clear ();
+  Object::DoDispose ();
+}
+
 void
 Tpa::SetTrafficType (std::string stype)
 {
-  if (stype == "PING")     {m_trafficType = PING;}   //std::cout << "Traffic type set for Ping application" << std::endl; 
-  if (stype == "UDPCBR")   {m_trafficType = UDPCBR;} //std::cout << "Traffic type set for OnOff application used as CBR" << std::endl;
-  if (stype == "TCPCBR")   {m_trafficType = TCPCBR;} //std::cout << "Traffic type set for OnOff application used as CBR" << std::endl;
-  if (stype == "VOIP")     {m_trafficType = VOIP;}   //std::cout << "Traffic type set for OnOff application used for VoIP" << std::endl;
-  if (stype == "VIDEO_S")    {m_trafficType = VIDEO_S;}  //std::cout << "Traffic type set for UdpTrace application; Video streaming" << std::endl;
+  // the string is only parsed here; the packets go straight to the loaders of the parser
+  if (stype == "PING")     {m_trafficType = PING;    SetParser<TpaEchoParser> ();}     //std::cout << "Traffic type set for Ping application" << std::endl; 
+  if (stype == "UDPCBR")   {m_trafficType = UDPCBR;  SetParser<TpaOnOffParser> ();}    //std::cout << "Traffic type set for OnOff application used as CBR" << std::endl;
+  if (stype == "TCPCBR")   {m_trafficType = TCPCBR;  SetUnknownParser (); NS_LOG_WARN ("Tpa: no TCP parser yet, the TCPCBR packets are ignored");}
+  if (stype == "VOIP")     {m_trafficType = VOIP;    SetParser<TpaOnOffParser> ();}    //std::cout << "Traffic type set for OnOff application used for VoIP" << std::endl;
+  if (stype == "VIDEO_S")  {m_trafficType = VIDEO_S; SetParser<TpaUdpTraceParser> ();} //std::cout << "Traffic type set for UdpTrace application; Video streaming" << std::endl;
   if (m_trafficType == 55) {std::cout << "Traffic type Syntax Error" << std::endl; }
 }
 
-void 
+void
+Tpa::SetStreamingMode (bool enable)
+{
+  m_streaming = enable;
+  m_throughputBins.SetMaxBins (enable ? 1024 : 0);  // the older bins go to a temporary file
+}
+
+bool
+Tpa::IsStreamingMode (void) const
+{
+  return m_streaming;
+}
+
+void
+Tpa::SetInFlightWindow (uint32_t size)
+{
+  m_flows.SetWindowSize (size);
+}
+
+uint32_t
+Tpa::GetInFlightWindow (void) const
+{
+  return m_flows.GetWindowSize ();
+}
+
+void
+Tpa::SetReorderWindow (uint32_t size)
+{
+  m_flows.SetReorderWindowSize (size);
+}
+
+uint32_t
+Tpa::GetReorderWindow (void) const
+{
+  return m_flows.GetReorderWindowSize ();
+}
+
+const TpaReorderStats &
+Tpa::GetReorderStats (void) const
+{
+  return m_reorder;
+}
+
+void
+Tpa::SetLossGmin (uint32_t gmin)
+{
+  m_flows.SetLossGmin (gmin);
+}
+
+uint32_t
+Tpa::GetLossGmin (void) const
+{
+  return m_flows.GetLossGmin ();
+}
+
+TpaLossRuns
+Tpa::GetLossRuns (void) const
+{
+  TpaLossRuns lossRuns;
+  for (uint32_t flow = 0; flow < m_flows.GetNFlows (); flow++)
+    {
+      lossRuns.Merge (m_flows.GetLossRuns (flow));
+    }
+  return lossRuns;
+}
+
+void
+Tpa::SetCodec (std::string codec)
+{
+  if (!m_eModel.SetCodec (codec))
+    {
+      NS_FATAL_ERROR ("Tpa: unknown codec \"" << codec << "\", expected G.711, G.729 or G.722");
+    }
+}
+
+std::string
+Tpa::GetCodec (void) const
+{
+  return m_eModel.GetCodec ();
+}
+
+void
+Tpa::SetVideoTrace (std::string fileName)
+{
+  m_videoTraceFile = fileName;
+  m_videoTrace.Close ();
+  if (!fileName.empty () && !m_videoTrace.Open (fileName, m_videoPacketSize))
+    {
+      NS_FATAL_ERROR ("Tpa: can't read the video trace " << fileName);
+    }
+  m_video.SetTrace (&m_videoTrace);
+}
+
+std::string
+Tpa::GetVideoTrace (void) const
+{
+  return m_videoTraceFile;
+}
+
+void
+Tpa::SetVideoPacketSize (uint32_t size)
+{
+  m_videoPacketSize = size;
+}
+
+uint32_t
+Tpa::GetVideoPacketSize (void) const
+{
+  return m_videoPacketSize;
+}
+
+TpaVideoQuality
+Tpa::GetVideoQuality (void) const
+{
+  return m_video.GetQuality ();
+}
+
+const TpaFlowTable &
+Tpa::GetFlowTable (void) const
+{
+  return m_flows;
+}
+
+void
+Tpa::SetReportInterval (Time interval)
+{
+  m_reportEvent.Cancel ();
+  m_reportInterval = interval;
+  ResetInterval ();
+  if (m_reportInterval.IsStrictlyPositive ())
+    {
+      m_reportEvent = Simulator::Schedule (m_reportInterval, &Tpa::Report, this);
+    }
+}
+
+Time
+Tpa::GetReportInterval (void) const
+{
+  return m_reportInterval;
+}
+
+void
+Tpa::SetReportStream (Ptr<OutputStreamWrapper> stream)
+{
+  m_reportStream = stream;
+  m_reportHeader = false;
+}
+
+void
+Tpa::SetOutputDirectory (std::string directory)
+{
+  m_outputDirectory = directory;
+}
+
+std::string
+Tpa::GetOutputDirectory (void) const
+{
+  return m_outputDirectory;
+}
+
+void
+Tpa::SetRunId (std::string runId)
+{
+  m_runId = runId;
+}
+
+std::string
+Tpa::GetRunId (void) const
+{
+  return m_runId;
+}
+
+std::string
+Tpa::GetOutputFileName (std::string name, std::string extension) const
+{
+  return TpaOutputFile::GetFileName (m_outputDirectory, name, m_runId, extension);
+}
+
+bool
+Tpa::OpenOutput (TpaOutputFile &file, std::string name, std::string extension) const
+{
+  std::string fileName = GetOutputFileName (name, extension);
+  if (!file.Open (fileName))
+    {
+      std::cout << "Tpa: cannot create " << fileName << std::endl;
+      return false;
+    }
+  return true;
+}
+
+void
+Tpa::CommitOutput (TpaOutputFile &file) const
+{
+  if (file.IsOpen () && !file.Commit ())
+    {
+      std::cout << "Tpa: a result file could not be written completely, it was not replaced" << std::endl;
+    }
+}
+
+void
+Tpa::SetThroughputBins (std::string widths)
+{
+  std::vector<double> binWidths;
+  if (!TpaThroughputBins::ParseBinWidths (widths, binWidths))
+    {
+      NS_FATAL_ERROR ("Tpa: bad ThroughputBins \"" << widths << "\", expected bin widths in ms like 10,100,1000");
+    }
+  m_throughputBinWidths = widths;
+  m_throughputBins.SetBinWidths (binWidths);
+}
+
+std::string
+Tpa::GetThroughputBins (void) const
+{
+  return m_throughputBinWidths;
+}
+
+void
+Tpa::SetRecordFile (std::string fileName)
+{
+  m_recordWriter.Close ();
+  m_recordFile = fileName;
+  if (!fileName.empty () && !m_recordWriter.Open (fileName))
+    {
+      NS_FATAL_ERROR ("Tpa: can't create the record file " << fileName);
+    }
+}
+
+std::string
+Tpa::GetRecordFile (void) const
+{
+  return m_recordFile;
+}
+
+void
+Tpa::SetRecordQueue (uint32_t capacity)
+{
+  m_recordQueue = capacity;
+  m_recordWriter.SetQueue (m_recordQueue, m_recordDropWhenFull);
+}
+
+uint32_t
+Tpa::GetRecordQueue (void) const
+{
+  return m_recordQueue;
+}
+
+void
+Tpa::SetRecordDropWhenFull (bool drop)
+{
+  m_recordDropWhenFull = drop;
+  m_recordWriter.SetQueue (m_recordQueue, m_recordDropWhenFull);
+}
+
+bool
+Tpa::GetRecordDropWhenFull (void) const
+{
+  return m_recordDropWhenFull;
+}
+
+void
+Tpa::Report (void)
+{
+  if (m_reportStream == 0)
+    {
+      m_reportStream = Create<OutputStreamWrapper> (GetOutputFileName ("tempseries", ".txt"),
+                                                    std::ios::out | std::ios::app);
+    }
+  std::ostream *os = m_reportStream->GetStream ();
+  if (!m_reportHeader)
+    {
+      *os << "#Time[s]  Th[Kbps]  Pl[%]  D[ms]  D99[ms]  J[ms]  Ns  Nr  R  MOS" << std::endl;
+      m_reportHeader = true;
+    }
+
+  // the loss compares the packets sent and received in the same interval,
+  // packets still in flight at the end of the interval count as lost
+  double seconds = m_reportInterval.GetSeconds ();
+  double loss = 0.0;
+  if (m_intervalSent > m_intervalReceived)
+    {
+      loss = (m_intervalSent - m_intervalReceived) / double (m_intervalSent) * 100;
+    }
+  *os << std::fixed << std::setprecision (3) << Simulator::Now ().GetSeconds ();
+  *os << std::setprecision (2);
+  *os << "  " << (m_intervalBytes * 8 / 1024.0) / seconds;   // [Kbps]
+  *os << "  " << loss;
+  *os << "  " << m_intervalDelay.GetMean ();
+  *os << "  " << m_intervalDelayHistogram.GetQuantile (0.99);
+  *os << "  " << m_intervalJitter.GetMean ();
+  *os << "  " << m_intervalSent;
+  *os << "  " << m_intervalReceived;
+  double burstRatio = TpaLossRuns::GetBurstRatio (m_intervalLost, m_intervalReceived, m_intervalLossRuns);
+  double r = m_eModel.GetR (OneWayDelay (m_intervalDelay.GetMean ()), loss, burstRatio);
+  *os << "  " << r;
+  *os << "  " << TpaEModel::GetMos (r);
+  *os << std::endl;
+
+  ResetInterval ();
+  m_reportEvent = Simulator::Schedule (m_reportInterval, &Tpa::Report, this);
+}
+
+void
+Tpa::AddIntervalDelay (double delay, double jitter)
+{
+  m_intervalDelay.Add (delay);
+  m_intervalDelayHistogram.Add (delay);
+  if (jitter >= 0.0)
+    {
+      m_intervalJitter.Add (jitter);
+    }
+}
+
+void
+Tpa::ResetInterval (void)
+{
+  m_intervalSent = 0;
+  m_intervalReceived = 0;
+  m_intervalBytes = 0;
+  m_intervalLost = 0;
+  m_intervalLossRuns = 0;
+  m_intervalDelay.Reset ();
+  m_intervalJitter.Reset ();
+  m_intervalDelayHistogram.Reset ();
+}
+
+void
 Tpa::LoadSentPacket (Ptr<const Packet> p_loadedPacket, double timeNow)
 {
-  switch (m_trafficType)
-  {
-    case PING:
-      LoadSentEchoRequestPacket (p_loadedPacket, timeNow);
-      break;
-    case UDPCBR:
-      LoadSentOnOffPacket (p_loadedPacket, timeNow);
-      break;
-
-    case VOIP:
-      LoadSentOnOffPacket (p_loadedPacket, timeNow);
-      break;
-    case VIDEO_S:
-      LoadSentUdpTracePacket (p_loadedPacket, timeNow);
-      break;
-    default:
-      std::cout << "Traffic type in Tpa::LoadSentPacket NOT implemented yet" << std::endl;
-  }
+  (this->*m_loadSent) (p_loadedPacket, TpaMsToNs (timeNow));
 }
 
 void
 Tpa::LoadReceivedPacket (Ptr<const Packet> p_loadedPacket, double timeNow)
 {
-  switch (m_trafficType)
-  {
-    case PING:
-      LoadReceivedEchoReplyPacket (p_loadedPacket, timeNow);
-      break;
-    case UDPCBR:
-      LoadReceivedOnOffPacket (p_loadedPacket, timeNow);
-      break;
-
-    case VOIP:
-      LoadReceivedOnOffPacket (p_loadedPacket, timeNow);
-      break;
-    case VIDEO_S:
-      LoadReceivedUdpTracePacket (p_loadedPacket, timeNow);
-      break;
-    default:
-      std::cout << "Traffic type in Tpa::LoadReceivedPacket NOT implemented yet" << std::endl;
-  }
+  (this->*m_loadReceived) (p_loadedPacket, TpaMsToNs (timeNow));
 }
 
+void
+Tpa::LoadSentPacket (Ptr<const Packet> p_loadedPacket, Time timeNow)
+{
+  (this->*m_loadSent) (p_loadedPacket, timeNow.GetNanoSeconds ());
+}
 
+void
+Tpa::LoadReceivedPacket (Ptr<const Packet> p_loadedPacket, Time timeNow)
+{
+  (this->*m_loadReceived) (p_loadedPacket, timeNow.GetNanoSeconds ());
+}
+
+Callback<void, Ptr<const Packet> >
+Tpa::GetSentCallback (void) const
+{
+  return m_sentCallback;
+}
+
+Callback<void, Ptr<const Packet> >
+Tpa::GetReceivedCallback (void) const
+{
+  return m_receivedCallback;
+}
 
 void
-Tpa::PrintTrafficPerformances ()
+Tpa::SetLoadUntil (Time time)
 {
-  //Calculating performances
-  m_sentPacketsNumber = m_next_sentPacketIndex;
-  m_receivedPacketsNumber = m_next_receivedPacketIndex;
-  m_startTrafficTime = receivedDataArray[0].receivedTime;
-  m_stopTrafficTime = receivedDataArray[m_next_receivedPacketIndex - 1].receivedTime;
+  m_loadUntil = time;
+}
+
+Time
+Tpa::GetLoadUntil (void) const
+{
+  return m_loadUntil;
+}
+
+bool
+Tpa::IsLoading (void) const
+{
+  return m_loadUntil.IsZero () || Simulator::Now () < m_loadUntil;
+}
+
+bool
+Tpa::CalculateTrafficPerformances (void)
+{
+  // the delays of the buffered mode are added to the histograms here, only once
+  if (m_calculated)
+    {
+      return m_receivedPacketsNumber > 0;
+    }
+  m_calculated = true;
+  if (m_streaming)
+    {
+      // everything is already accumulated while loading the packets
+      m_sentPacketsNumber = m_streamSent;
+      m_receivedPacketsNumber = m_streamReceived;
+    }
+  else
+    {
+      m_sentPacketsNumber = sentDataArray.sentTime.GetSize ();
+      m_receivedPacketsNumber = receivedDataArray.receivedTime.GetSize ();
+    }
+  if (m_receivedPacketsNumber == 0)
+    {
+      m_throughput = 0.0;
+      m_receivedBytes = 0;
+      m_packetLossPercentage = m_sentPacketsNumber > 0 ? 100.0 : 0.0;
+      m_endToEndDelayAvg = 0.0;
+      m_Jitter = 0.0;
+      m_rValue = 0.0;
+      m_mos = TpaEModel::GetMos (m_rValue);
+      m_L3Th = CalculateHandoverTime ();
+      return false;
+    }
+  if (!m_streaming)
+    {
+      m_startTrafficTime = receivedDataArray.receivedTime[0];
+      m_stopTrafficTime = receivedDataArray.receivedTime.Back ();
+    }
   m_throughput = CalculateThroughput ();
   m_packetLossPercentage = CalculatePacketLossPrecentage ();
-  m_endToEndDelayAvg = CalculateEndToEndDelayAvg ();
-  m_Jitter = CalculateJitterAvg ();
+  m_endToEndDelayAvg = m_streaming ? (m_delays > 0 ? TpaNsToMs (m_delaySum) / m_delays : 0.0) : CalculateEndToEndDelayAvg ();
+  m_Jitter = m_streaming ? (m_jitters > 0 ? TpaNsToMs (m_jitterSum) / m_jitters : 0.0) : CalculateJitterAvg ();
   m_rValue = CalculateR_Value ();
+  m_mos = TpaEModel::GetMos (m_rValue);
   m_L3Th = CalculateHandoverTime ();
+  return true;
+}
+
+TpaNodeSummary
+Tpa::GetSummary (void)
+{
+  CalculateTrafficPerformances ();
+  TpaNodeSummary summary;
+  summary.sent = m_sentPacketsNumber;
+  summary.received = m_receivedPacketsNumber;
+  summary.bytes = m_receivedBytes;
+  summary.duration = m_receivedPacketsNumber > 0 ? GetTrafficDuration () : 0.0;
+  summary.throughput = m_throughput;
+  summary.loss = m_packetLossPercentage;
+  summary.delay = m_endToEndDelayAvg;
+  summary.jitter = m_Jitter;
+  summary.delayP99 = m_delayHistogram.GetQuantile (0.99);
+  summary.rValue = m_rValue;
+  summary.mos = m_mos;
+  summary.delays = m_delayHistogram.GetCount ();
+  summary.jitters = m_jitterHistogram.GetCount ();
+  summary.handovers = GetNHandovers ();
+  summary.l3Delay = m_L3Th * 1000;
+  return summary;
+}
+
+const TpaHistogram &
+Tpa::GetDelayHistogram (void) const
+{
+  return m_delayHistogram;
+}
+
+const TpaHistogram &
+Tpa::GetJitterHistogram (void) const
+{
+  return m_jitterHistogram;
+}
+
+void
+Tpa::PrintTrafficPerformances ()
+{
+  if (m_recordWriter.IsOpen ())
+    {
+      m_recordWriter.Close (); // the counts go in the header, the file is complete
+      if (m_recordWriter.GetDropped () > 0)
+        {
+          std::cout << "Tpa: " << m_recordWriter.GetDropped () << " records dropped, record queue full" << std::endl;
+        }
+    }
+
+  if (!CalculateTrafficPerformances ())
+    {
+      std::cout << "No application packets received, nothing to analyze" << std::endl;
+      return;
+    }
 
 
 /*
-  for (int i = 0; i < m_sentPacketsNumber; i++) { std::cout <<  "Echo request sent with ID= " << sentDataArray[i].packetID << " time:" << sentDataArray[i].sentTime << std::endl;}
-  for (int j = 0; j < m_receivedPacketsNumber; j++) { std::cout <<  "Echo reply received with ID= " << receivedDataArray[j].packetID << " time:" << 
-receivedDataArray[j].receivedTime << std::endl;}
-int m_elementsNumber_delaysTempArray = delaysTempArray.size ();
+  for (int i = 0; i < m_sentPacketsNumber; i++) { std::cout <<  "Echo request sent with ID= " << uint32_t (sentDataArray.key[i]) << " time:" << TpaNsToMs (sentDataArray.sentTime[i]) << std::endl;}
+  for (int j = 0; j < m_receivedPacketsNumber; j++) { std::cout <<  "Echo reply received with ID= " << uint32_t (receivedDataArray.key[j]) << " time:" << 
+TpaNsToMs (receivedDataArray.receivedTime[j]) << std::endl;}
+int m_elementsNumber_delaysTempArray = delaysTempArray.GetSize ();
   for (int k = 0; k < m_elementsNumber_delaysTempArray; k++) { std::cout << k << "- delay" << delaysTempArray[k] << std::endl;}
 */
 
@@ -159,6 +758,31 @@ if (m_enable_column_labels) // disable when generating results with bash scripts
     std::cout << std::left << std::setw(8) << "Nr";       //8 - Received packets
     std::cout << std::left << std::setw(8) << "Nd";       //9 - Dropped
     std::cout << std::left << std::setw(8) << "T[s]";     //10- Application time
+    std::cout << std::left << std::setw(8) << "D50";      //11- Delay percentiles [ms]
+    std::cout << std::left << std::setw(8) << "D90";      //12
+    std::cout << std::left << std::setw(8) << "D95";      //13
+    std::cout << std::left << std::setw(8) << "D99";      //14
+    std::cout << std::left << std::setw(8) << "D99.9";    //15
+    std::cout << std::left << std::setw(8) << "Dmax";     //16
+    std::cout << std::left << std::setw(8) << "J50";      //17- Jitter percentiles [ms]
+    std::cout << std::left << std::setw(8) << "J90";      //18
+    std::cout << std::left << std::setw(8) << "J95";      //19
+    std::cout << std::left << std::setw(8) << "J99";      //20
+    std::cout << std::left << std::setw(8) << "J99.9";    //21
+    std::cout << std::left << std::setw(8) << "Jmax";     //22
+    std::cout << std::left << std::setw(8) << "Nr_dir";   //23- Received directly
+    std::cout << std::left << std::setw(8) << "Nr_tun";   //24- Received through the HA tunnel
+    std::cout << std::left << std::setw(8) << "Nr_ro";    //25- Received route optimized
+    std::cout << std::left << std::setw(8) << "Nreo";     //26- Reordered
+    std::cout << std::left << std::setw(8) << "Reo[%]";   //27- Reordered / received
+    std::cout << std::left << std::setw(8) << "Ndup";     //28- Duplicated
+    std::cout << std::left << std::setw(8) << "p[%]";     //29- Gilbert-Elliott gap -> burst
+    std::cout << std::left << std::setw(8) << "r[%]";     //30- Gilbert-Elliott burst -> gap
+    std::cout << std::left << std::setw(8) << "Bd[%]";    //31- Burst density
+    std::cout << std::left << std::setw(8) << "Gd[%]";    //32- Gap density
+    std::cout << std::left << std::setw(8) << "MOS";      //33- E-model MOS
+    std::cout << std::left << std::setw(8) << "BurstR";   //34- Burst ratio of the losses
+    std::cout << std::left << std::setw(8) << "Nh";       //35- Handovers, then 10 fields each (see below)
     std::cout << std::endl;
   }
 
@@ -171,12 +795,37 @@ if (m_enable_column_labels) // disable when generating results with bash scripts
   std::cout << std::left << std::setw(8)  << m_sentPacketsNumber;     //7 
   std::cout << std::left << std::setw(8)  << m_receivedPacketsNumber; //8
   std::cout << std::left << std::setw(8)  << m_sentPacketsNumber - m_receivedPacketsNumber;      //9
-  std::cout << std::left << std::setw(8)  << int ((m_stopTrafficTime - m_startTrafficTime) / 1000.0 + 0.5);    //10
+  std::cout << std::left << std::setw(8)  << int (GetTrafficDuration () / 1000.0 + 0.5);    //10
+  for (int i = 0; i < 6; i++)
+    {
+      std::cout << std::left << std::setw(8) << m_delayHistogram.GetQuantile (g_reportedQuantiles[i]);  //11-16
+    }
+  for (int i = 0; i < 6; i++)
+    {
+      std::cout << std::left << std::setw(8) << m_jitterHistogram.GetQuantile (g_reportedQuantiles[i]); //17-22
+    }
+  std::cout << std::left << std::setw(8)  << m_receivedDirect;        //23
+  std::cout << std::left << std::setw(8)  << m_receivedTunnel;        //24
+  std::cout << std::left << std::setw(8)  << m_receivedRo;            //25
+  std::cout << std::left << std::setw(8)  << m_reorder.GetReordered ();      //26
+  std::cout << std::left << std::setw(8)  << m_reorder.GetReorderedRatio (); //27
+  std::cout << std::left << std::setw(8)  << m_reorder.GetDuplicates ();     //28
+  TpaLossRuns lossRuns = GetLossRuns ();
+  TpaGilbertElliott lossModel = lossRuns.GetModel ();
+  std::cout << std::left << std::setw(8)  << lossModel.p * 100;            //29
+  std::cout << std::left << std::setw(8)  << lossModel.r * 100;            //30
+  std::cout << std::left << std::setw(8)  << lossModel.burstDensity * 100; //31
+  std::cout << std::left << std::setw(8)  << lossModel.gapDensity * 100;   //32
+  std::cout << std::left << std::setw(8)  << m_mos;                        //33
+  std::cout << std::left << std::setw(8)  << lossRuns.GetBurstRatio ();    //34
+  std::cout << std::left << std::setw(8)  << GetNHandovers ();        //35
   std::cout << std::endl; // for bash scripts, the new line is inserted from script
   //std::cout << "\n" << std::endl;
  
   //Output result to file (for parsing)
-  std::ofstream r_out("/root/workspace/bake/source/ns-3-dce/tempresults.txt");
+  TpaOutputFile resultsFile;
+  OpenOutput (resultsFile, "tempresults", ".txt");
+  std::ostream &r_out = resultsFile.GetStream ();
   
   r_out << std::fixed << std::setprecision(2) << m_throughput << "*"; //1
   r_out << m_packetLossPercentage << "*";  //2
@@ -187,7 +836,94 @@ if (m_enable_column_labels) // disable when generating results with bash scripts
   r_out << m_sentPacketsNumber << "*";     //7 
   r_out << m_receivedPacketsNumber << "*";//8
   r_out << m_sentPacketsNumber - m_receivedPacketsNumber << "*";      //9
-  r_out << int ((m_stopTrafficTime - m_startTrafficTime) / 1000.0 + 0.5);    //10
+  r_out << int (GetTrafficDuration () / 1000.0 + 0.5);    //10
+  for (int i = 0; i < 6; i++)
+    {
+      r_out << "*" << m_delayHistogram.GetQuantile (g_reportedQuantiles[i]);  //11-16
+    }
+  for (int i = 0; i < 6; i++)
+    {
+      r_out << "*" << m_jitterHistogram.GetQuantile (g_reportedQuantiles[i]); //17-22
+    }
+  r_out << "*" << m_receivedDirect;        //23
+  r_out << "*" << m_receivedTunnel;        //24
+  r_out << "*" << m_receivedRo;            //25
+  r_out << "*" << m_reorder.GetReordered ();      //26
+  r_out << "*" << m_reorder.GetReorderedRatio (); //27
+  r_out << "*" << m_reorder.GetDuplicates ();     //28
+  r_out << "*" << lossModel.p * 100;            //29
+  r_out << "*" << lossModel.r * 100;            //30
+  r_out << "*" << lossModel.burstDensity * 100; //31
+  r_out << "*" << lossModel.gapDensity * 100;   //32
+  r_out << "*" << m_mos;                        //33
+  r_out << "*" << lossRuns.GetBurstRatio ();    //34
+  r_out << "*" << GetNHandovers ();        //35
+  for (uint32_t i = 0; i < GetNHandovers (); i++)
+    {
+      // 36.. - per handover: Ts[s] L3[ms] O[ms] Nl Db Dd Da Jb Jd Ja
+      GetHandoverImpact (i).Print (r_out, "*");
+    }
+  CommitOutput (resultsFile);
+
+  // The histograms themselves, to pool the percentiles of several replications
+  TpaOutputFile sketchesFile;
+  OpenOutput (sketchesFile, "tempsketches", ".txt");
+  std::ostream &h_out = sketchesFile.GetStream ();
+  h_out << "delay ";  m_delayHistogram.Print (h_out);  h_out << std::endl;
+  h_out << "jitter "; m_jitterHistogram.Print (h_out); h_out << std::endl;
+  h_out << "reorder_extent "; m_reorder.Print (h_out); h_out << std::endl;
+  lossRuns.Print (h_out);
+  CommitOutput (sketchesFile);
+
+  // One line per flow: flow*Th[Kbps]*Pl[%]*D[ms]*J[ms]*Ns*Nr*Nreo*Ndup
+  TpaOutputFile flowsFile;
+  OpenOutput (flowsFile, "tempflows", ".txt");
+  m_flows.Print (flowsFile.GetStream (), "*");
+  CommitOutput (flowsFile);
+
+  // Everything above in one structured document
+  TpaOutputFile jsonFile;
+  OpenOutput (jsonFile, "results", ".json");
+  WriteResults (jsonFile.GetStream ());
+  CommitOutput (jsonFile);
+  if (m_enable_column_labels && m_flows.GetNFlows () > 1)
+    {
+      std::cout << "Flows (Th[Kbps] Pl[%] D[ms] J[ms] Ns Nr Nreo Ndup):" << std::endl;
+      m_flows.Print (std::cout, "  ");
+    }
+  if (m_trafficType == VIDEO_S && m_videoTrace.IsOpen ())
+    {
+      // Nf*If[%]*Pf[%]*Bf[%]*Q[%]*Fps*PSNR[dB]*MOS
+      TpaVideoQuality video = m_video.GetQuality ();
+      TpaOutputFile videoFile;
+      OpenOutput (videoFile, "tempvideo", ".txt");
+      std::ostream &v_out = videoFile.GetStream ();
+      v_out << std::fixed << std::setprecision (2) << video.GetSent ();
+      video.Print (v_out, "*");
+      v_out << std::endl;
+      CommitOutput (videoFile);
+      if (m_enable_column_labels)
+        {
+          std::cout << "Video frames (Nf If[%] Pf[%] Bf[%] Q[%] Fps PSNR[dB] MOS):" << std::endl;
+          std::cout << video.GetSent ();
+          video.Print (std::cout, "  ");
+          std::cout << std::endl;
+        }
+    }
+  if (m_enable_column_labels)
+    {
+      m_handovers.Print (std::cout);
+      if (GetNHandovers () > 0)
+        {
+          std::cout << "Handover impact (Ts[s] L3[ms] O[ms] Nl Db Dd Da Jb Jd Ja [ms]):" << std::endl;
+        }
+      for (uint32_t i = 0; i < GetNHandovers (); i++)
+        {
+          std::cout << i + 1;
+          GetHandoverImpact (i).Print (std::cout, "  ");
+          std::cout << std::endl;
+        }
+    }
   //std::cout << std::endl;
 }
 
@@ -195,242 +931,552 @@ if (m_enable_column_labels) // disable when generating results with bash scripts
 void 
 Tpa::PrintThroughput ()
 {
-  std::ofstream tout("/root/workspace/bake/source/ns-3-dce/Throughput.txt");
-  tout << "#Time_interval    Throughput[Kbps]" << std::endl;
+  // the bins are filled as the packets are received, in both modes
+  TpaOutputFile throughputFile;
+  OpenOutput (throughputFile, "Throughput", ".txt");
+  m_throughputBins.Print (throughputFile.GetStream ());
+  CommitOutput (throughputFile);
+}
 
-  uint32_t m_throughput; // in bytes
-  double next_packet_received_time;
+// JSON has no NaN or infinity
+static void
+WriteJsonNumber (std::ostream &os, double value)
+{
+  if (value != value || value > 1e300 || value < -1e300)
+    {
+      os << "null";
+      return;
+    }
+  os << value;
+}
 
-  for (double i = 0; i < (m_stopTrafficTime)/1000; i=i+1 )
+static void
+WriteJsonString (std::ostream &os, const std::string &value)
+{
+  os << '"';
+  for (uint32_t i = 0; i < value.size (); i++)
     {
-      static double j = 1;
-      m_throughput = 0;
+      unsigned char c = value[i];
+      if (c == '"' || c == '\\')
+        {
+          os << '\\' << c;
+        }
+      else if (c < 0x20)
+        {
+          os << "\\u00" << "0123456789abcdef"[c >> 4] << "0123456789abcdef"[c & 0xf];
+        }
+      else
+        {
+          os << c;
+        }
+    }
+  os << '"';
+}
+
+// "name": value, the first one of an object without the comma
+static void
+WriteJsonField (std::ostream &os, const char *name, double value, bool first = false)
+{
+  os << (first ? "" : ", ") << '"' << name << "\": ";
+  WriteJsonNumber (os, value);
+}
 
-      do
+void
+Tpa::WriteResults (std::ostream &os)
+{
+  bool analyzed = CalculateTrafficPerformances ();
+  std::ios::fmtflags flags = os.flags ();
+  std::streamsize precision = os.precision ();
+  os.unsetf (std::ios::floatfield);
+  os << std::setprecision (12);
+
+  const char *trafficType = "unknown";
+  switch (m_trafficType)
+    {
+    case PING:    trafficType = "PING"; break;
+    case UDPCBR:  trafficType = "UDPCBR"; break;
+    case TCPCBR:  trafficType = "TCPCBR"; break;
+    case VOIP:    trafficType = "VOIP"; break;
+    case VIDEO_S: trafficType = "VIDEO_S"; break;
+    }
+  os << "{\"schemaVersion\": " << RESULTS_SCHEMA_VERSION;
+  os << ", \"runId\": ";
+  WriteJsonString (os, m_runId);
+  os << ", \"trafficType\": \"" << trafficType << "\"";
+  os << ", \"streaming\": " << (m_streaming ? "true" : "false");
+  os << ", \"codec\": ";
+  WriteJsonString (os, GetCodec ());
+  os << ", \"analyzed\": " << (analyzed ? "true" : "false");
+  WriteJsonField (os, "sent", m_sentPacketsNumber);
+  WriteJsonField (os, "received", m_receivedPacketsNumber);
+  if (!analyzed)
+    {
+      os << "}" << std::endl;
+      os.flags (flags);
+      os.precision (precision);
+      return;
+    }
+  WriteJsonField (os, "receivedBytes", m_receivedBytes);
+  WriteJsonField (os, "durationMs", GetTrafficDuration ());
+  WriteJsonField (os, "throughputKbps", m_throughput);
+  WriteJsonField (os, "lossPercent", m_packetLossPercentage);
+  WriteJsonField (os, "rValue", m_rValue);
+  WriteJsonField (os, "mos", m_mos);
+  WriteJsonField (os, "l3DelayMs", m_L3Th * 1000);
+
+  os << ", \"delayMs\": {";
+  WriteJsonField (os, "mean", m_endToEndDelayAvg, true);
+  for (int i = 0; i < 6; i++)
+    {
+      WriteJsonField (os, g_quantileNames[i], m_delayHistogram.GetQuantile (g_reportedQuantiles[i]));
+    }
+  os << "}, \"jitterMs\": {";
+  WriteJsonField (os, "mean", m_Jitter, true);
+  for (int i = 0; i < 6; i++)
+    {
+      WriteJsonField (os, g_quantileNames[i], m_jitterHistogram.GetQuantile (g_reportedQuantiles[i]));
+    }
+  os << "}, \"paths\": {";
+  WriteJsonField (os, "direct", m_receivedDirect, true);
+  WriteJsonField (os, "tunnel", m_receivedTunnel);
+  WriteJsonField (os, "routeOptimized", m_receivedRo);
+  os << "}, \"reordering\": {";
+  WriteJsonField (os, "reordered", m_reorder.GetReordered (), true);
+  WriteJsonField (os, "reorderedRatio", m_reorder.GetReorderedRatio ());
+  WriteJsonField (os, "duplicates", m_reorder.GetDuplicates ());
+  TpaLossRuns lossRuns = GetLossRuns ();
+  TpaGilbertElliott lossModel = lossRuns.GetModel ();
+  os << "}, \"lossRuns\": {";
+  WriteJsonField (os, "lost", lossRuns.GetLost (), true);
+  WriteJsonField (os, "maxRun", lossRuns.GetMaxLossRun ());
+  WriteJsonField (os, "meanRun", lossRuns.GetMeanLossRun ());
+  WriteJsonField (os, "burstRatio", lossRuns.GetBurstRatio ());
+  WriteJsonField (os, "p", lossModel.p);
+  WriteJsonField (os, "r", lossModel.r);
+  WriteJsonField (os, "burstDensity", lossModel.burstDensity);
+  WriteJsonField (os, "gapDensity", lossModel.gapDensity);
+  os << "}";
+
+  // the times of the handover impact are in ms, its start too
+  os << ", \"handovers\": [";
+  static const char *windows[3] = { "before", "during", "after" };
+  for (uint32_t i = 0; i < GetNHandovers (); i++)
+    {
+      TpaHandoverImpact impact = GetHandoverImpact (i);
+      os << (i == 0 ? "{" : ", {");
+      WriteJsonField (os, "startMs", impact.start, true);
+      WriteJsonField (os, "endMs", impact.end);
+      WriteJsonField (os, "l3DelayMs", impact.l3Delay);
+      WriteJsonField (os, "outageMs", impact.GetOutage ());
+      WriteJsonField (os, "outageSent", impact.outageSent);
+      WriteJsonField (os, "outageDelivered", impact.outageDelivered);
+      WriteJsonField (os, "lost", impact.GetLost ());
+      os << ", \"delayMs\": {";
+      for (int w = 0; w < 3; w++)
+        {
+          WriteJsonField (os, windows[w], impact.delay[w], w == 0);
+        }
+      os << "}, \"jitterMs\": {";
+      for (int w = 0; w < 3; w++)
         {
-          static int k = 0;
-          m_throughput = m_throughput + receivedDataArray[k].packetSize;
-          if (k < m_receivedPacketsNumber) {k = k+1;} else {return;}
-          next_packet_received_time = (receivedDataArray[k].receivedTime)/1000; // ms/1000 = sec 
-        }while(next_packet_received_time < j);
+          WriteJsonField (os, windows[w], impact.jitter[w], w == 0);
+        }
+      os << "}}";
+    }
+  os << "]";
 
-      tout << int (j) << "        " << (m_throughput * 8)/1024  << std::endl; // in Kbps      
-      j = j + 1;
+  os << ", \"flows\": [";
+  for (uint32_t i = 0; i < m_flows.GetNFlows (); i++)
+    {
+      const TpaFlowKey &key = m_flows.GetKey (i);
+      const TpaFlowStats &stats = m_flows.GetStats (i);
+      uint8_t source[16];
+      uint8_t destination[16];
+      std::memcpy (source, key.source, 16);
+      std::memcpy (destination, key.destination, 16);
+      os << (i == 0 ? "{" : ", {");
+      os << "\"source\": \"" << Ipv6Address (source) << "\"";
+      WriteJsonField (os, "sourcePort", key.sourcePort);
+      os << ", \"destination\": \"" << Ipv6Address (destination) << "\"";
+      WriteJsonField (os, "destinationPort", key.destinationPort);
+      WriteJsonField (os, "protocol", key.protocol);
+      WriteJsonField (os, "flowLabel", key.flowLabel);
+      WriteJsonField (os, "sent", stats.sent);
+      WriteJsonField (os, "received", stats.received);
+      WriteJsonField (os, "throughputKbps", stats.GetThroughput ());
+      WriteJsonField (os, "lossPercent", stats.GetPacketLossPercentage ());
+      WriteJsonField (os, "delayMs", stats.delay.GetMean ());
+      WriteJsonField (os, "jitterMs", stats.jitter.GetMean ());
+      WriteJsonField (os, "reordered", stats.reordered);
+      WriteJsonField (os, "duplicates", stats.duplicates);
+      os << "}";
+    }
+  os << "]";
+
+  if (m_trafficType == VIDEO_S && m_videoTrace.IsOpen ())
+    {
+      TpaVideoQuality video = m_video.GetQuality ();
+      os << ", \"video\": {";
+      WriteJsonField (os, "frames", video.GetSent (), true);
+      WriteJsonField (os, "iLossPercent", video.GetLoss (TpaVideoFrame::I));
+      WriteJsonField (os, "pLossPercent", video.GetLoss (TpaVideoFrame::P));
+      WriteJsonField (os, "bLossPercent", video.GetLoss (TpaVideoFrame::B));
+      WriteJsonField (os, "decodable", video.decodable);
+      WriteJsonField (os, "q", video.q);
+      WriteJsonField (os, "fps", video.fps);
+      WriteJsonField (os, "psnrDb", video.psnr);
+      WriteJsonField (os, "mos", video.mos);
+      os << "}";
     }
+  os << "}" << std::endl;
+  os.flags (flags);
+  os.precision (precision);
 }
 
 
 void 
 Tpa::LoadControlPacket (Ptr<const Packet> p_lcp, double timeNow)  // lcp - loaded control packet
 {
-  if (timeNow > 16000) // msec
-    {    
+  LoadHandoverFrame (p_lcp, TpaMsToNs (timeNow), false);
+}
 
-      uint32_t packetSize = p_lcp -> GetSize();
+void
+Tpa::LoadControlPacket (Ptr<const Packet> p_lcp, Time timeNow)
+{
+  LoadHandoverFrame (p_lcp, timeNow.GetNanoSeconds (), false);
+}
 
-      if (packetSize == 50) // Association Response packet
-        {
-          Ptr<Packet> packet = p_lcp->Copy ();
-          WifiMacHeader wifimachdr;  packet->PeekHeader(wifimachdr);
-          Mac48Address mnmac("00:00:00:00:00:10"); // this is the MAC of the MN in the script, needed when backround traffic is introduced
-            if ( wifimachdr.IsAssocResp () and (wifimachdr.GetAddr1() == mnmac))
-              {
-                m_L3Ths = timeNow;
-              } 
-        }
- 
-     if (packetSize == 116)  // BA when MN moves to Foreign Network
-        {
-          m_L3Thf = timeNow; 
-        }
+void
+Tpa::LoadSentControlPacket (Ptr<const Packet> p_lcp, double timeNow)
+{
+  LoadHandoverFrame (p_lcp, TpaMsToNs (timeNow), true);
+}
 
-      if (packetSize == 92)  // BA when MN moves to Home Network (RS packet might be 92 bytes of size)
-        {
-          Ptr<Packet> packet = p_lcp->Copy ();
-          WifiMacHeader wifimachdr;  packet->RemoveHeader(wifimachdr);
-          LlcSnapHeader llcsnaphdr;  packet->RemoveHeader(llcsnaphdr);
-          Ipv6Header ipv6hdr;  packet->PeekHeader (ipv6hdr);
-          if (ipv6hdr.GetNextHeader () ==  135)  //  Mobile IPv6 header type 135 
-            {
-              m_L3Thf = timeNow;
-            }
-        }
-    }   
+void
+Tpa::LoadSentControlPacket (Ptr<const Packet> p_lcp, Time timeNow)
+{
+  LoadHandoverFrame (p_lcp, timeNow.GetNanoSeconds (), true);
 }
 
-//Private
+Callback<void, Ptr<const Packet> >
+Tpa::GetControlCallback (void)
+{
+  return MakeCallback (&Tpa::TraceControl, this);
+}
+
+Callback<void, Ptr<const Packet> >
+Tpa::GetSentControlCallback (void)
+{
+  return MakeCallback (&Tpa::TraceSentControl, this);
+}
 
 void
-Tpa::LoadSentEchoRequestPacket (Ptr<const Packet> p_lerp, double timeNow) //lerp - loaded echo request packet
+Tpa::TraceControl (Ptr<const Packet> packet)
 {
-  Ptr<Packet> packet = p_lerp->Copy (); 
-  EthernetHeader ethhdr;  packet->RemoveHeader (ethhdr); 
-  Ipv6Header ipv6hdr;  packet->RemoveHeader (ipv6hdr);
+  LoadControlPacket (packet, Simulator::Now ());
+}
+
+void
+Tpa::TraceSentControl (Ptr<const Packet> packet)
+{
+  LoadSentControlPacket (packet, Simulator::Now ());
+}
 
-  if (ipv6hdr.GetNextHeader () == 43) // Type 2 Routing IPv6 Extension Header in case of Route Optimization 
+void
+Tpa::LoadHandoverFrame (Ptr<const Packet> p_frame, int64_t timeNow, bool sent)
+{
+  // a handover started when the count of the finished and in progress ones grows,
+  // the ones the count of the finished ones grew by are finished; the phases are timed in ms
+  TpaPacketView view (p_frame);
+  uint32_t finished = m_handovers.GetNHandovers ();
+  uint32_t started = finished + (m_handovers.IsInProgress () ? 1 : 0);
+  m_handovers.LoadFrame (view, TpaNsToMs (timeNow), sent);
+  if (m_handovers.GetNHandovers () + (m_handovers.IsInProgress () ? 1 : 0) > started)
     {
-      //Ipv6ExtensionRoutingHeader ipv6eh;
-      Ipv6ExtensionDestinationHeader ipv6eh; // The Ipv6ExtensionRoutingHeader doesnt work, probably a bug?
-      packet->RemoveHeader (ipv6eh);
+      m_handoverTimeline.Begin (TpaNsToMs (timeNow));
     }
-
-  Icmpv6Header icmp6hdr;  packet->PeekHeader (icmp6hdr);
-  if (icmp6hdr.GetType () == Icmpv6Header::ICMPV6_ECHO_REQUEST)
+  for (uint32_t i = finished; i < m_handovers.GetNHandovers (); i++)
     {
-      static sentPacketParam spktPar = {};
+      m_handoverTimeline.Finish (i, m_handovers.GetHandover (i));
+    }
+}
 
-      spktPar.sentTime = timeNow;  
+void
+Tpa::SetMobileNodeAddress (Mac48Address address)
+{
+  uint8_t buffer[6];
+  address.CopyTo (buffer);
+  m_handovers.SetMobileNodeAddress (buffer);
+}
 
-      Icmpv6Echo icmp6EchoHdr;  packet->PeekHeader (icmp6EchoHdr);
-      spktPar.packetID = icmp6EchoHdr.GetSeq ();
-    
-      sentDataArray[m_next_sentPacketIndex] = spktPar;
-      m_next_sentPacketIndex = m_next_sentPacketIndex + 1;
-     }  
+const TpaHandoverDetector &
+Tpa::GetHandoverDetector (void) const
+{
+  return m_handovers;
 }
 
 void
-Tpa::LoadReceivedEchoReplyPacket (Ptr<const Packet> lerp, double timeNow)
-{  
-  // Echo-replys in CN in order to calculate the RTT Dealy
-  Ptr<Packet> packet = lerp->Copy ();    
-  EthernetHeader ethhdr;  packet->RemoveHeader (ethhdr); 
-  Ipv6Header ipv6hdr;  packet->RemoveHeader (ipv6hdr);
+Tpa::SetHandoverWindow (Time window)
+{
+  m_handoverTimeline.SetWindow (window.GetSeconds () * 1000);
+}
 
-  if (ipv6hdr.GetNextHeader () == 60) // Destination Option IPv6 Extension Header in case of Route Optimization
-    {
-      Ipv6ExtensionDestinationHeader ipv6doeh;
-      packet->RemoveHeader (ipv6doeh);  
-    }
+Time
+Tpa::GetHandoverWindow (void) const
+{
+  return Seconds (m_handoverTimeline.GetWindow () / 1000);
+}
 
-  Icmpv6Header icmp6hdr;  packet->PeekHeader (icmp6hdr);
-  if (icmp6hdr.GetType () == Icmpv6Header::ICMPV6_ECHO_REPLY)
-    {       
-      static receivedPacketParam rpktPar = {};
+void
+Tpa::SetHandoverMaxDuration (Time duration)
+{
+  m_handoverTimeline.SetMaxDuration (duration.GetSeconds () * 1000);
+}
+
+Time
+Tpa::GetHandoverMaxDuration (void) const
+{
+  return Seconds (m_handoverTimeline.GetMaxDuration () / 1000);
+}
 
-      rpktPar.receivedTime = timeNow;  
+uint32_t
+Tpa::GetNHandovers (void) const
+{
+  return m_handoverTimeline.GetNHandovers ();
+}
 
-      Icmpv6Echo icmp6EchoHdr;  packet->PeekHeader (icmp6EchoHdr);
-      rpktPar.packetID = icmp6EchoHdr.GetSeq ();
-    
-      receivedDataArray[m_next_receivedPacketIndex] = rpktPar;
-      m_next_receivedPacketIndex = m_next_receivedPacketIndex + 1;
-      //std::cout << "" << std::endl; 
-    } 
+TpaHandoverImpact
+Tpa::GetHandoverImpact (uint32_t i) const
+{
+  if (i < m_handovers.GetNHandovers ())
+    {
+      return m_handoverTimeline.GetImpact (i, m_handovers.GetHandover (i));
+    }
+  return m_handoverTimeline.GetImpact (i, m_handovers.GetCurrent ());
 }
 
+//Private
+
 void
-Tpa::LoadSentOnOffPacket (Ptr<const Packet> p_lofp, double timeNow)
+Tpa::AddSentRecord (uint32_t flow, uint32_t packetID, int64_t timeNow, uint32_t packetSize, uint8_t path)
 {
-  if(p_lofp->GetSize() > 200)
-  {  // filter OnOff packets from the rest (80 IP6-IP6 + 8 UDP + 172 VoIP payload = 260 bytes)
-     // all other controll packets are less than 200 bytes 
-    Ptr<Packet> packet = p_lofp->Copy ();   
-    EthernetHeader ethhdr;  packet->RemoveHeader (ethhdr); 
-    Ipv6Header ipv6hdr;     packet->RemoveHeader (ipv6hdr);
-/* Waiting for dce 1.3
-    if (ipv6hdr.GetNextHeader () == 43) // Type 2 Routing IPv6 Extension Header in case of Route Optimization 
-      {
-        //Ipv6ExtensionRoutingHeader ipv6eh;
-        Ipv6ExtensionDestinationHeader ipv6eh; // The Ipv6ExtensionRoutingHeader doesnt work, probably a bug?
-        packet->RemoveHeader (ipv6eh);
-      }
-*/
-    UdpHeader udphdr;       packet->RemoveHeader(udphdr);
-                            packet->PeekHeader(seqTs);
+  m_recordWriter.Add (TpaRecordWriter::SENT, packetID, timeNow, packetSize, flow, path);
+  TpaFlowStats &flowStats = m_flows.GetStats (flow);
+  flowStats.sent = flowStats.sent + 1;
+  m_intervalSent = m_intervalSent + 1;
+  m_handoverTimeline.AddSent (TpaNsToMs (timeNow));
+  if (m_trafficType == VIDEO_S && m_videoTrace.IsOpen ())
+    {
+      m_video.AddSent (packetID);
+    }
+
+  if (!m_streaming)
+    {
+      sentDataArray.sentTime.Push (timeNow);
+      sentDataArray.key.Push (TpaSeqIndex::MakeKey (flow, packetID));
+      if (m_reportInterval.IsStrictlyPositive ())
+        {
+          m_flows.GetWindow (flow).Insert (packetID, timeNow); // delays of the periodic report
+        }
+      return;
+    }
 
-    static sentPacketParam spktPar = {};
-    spktPar.sentTime = timeNow;  
-    spktPar.packetID = seqTs.GetSeq();
-    sentDataArray[m_next_sentPacketIndex] = spktPar;
-    m_next_sentPacketIndex = m_next_sentPacketIndex + 1;
-  } 
+  m_streamSent = m_streamSent + 1;
+  if (m_flows.GetWindow (flow).Insert (packetID, timeNow))
+    {
+      m_streamEvicted = m_streamEvicted + 1; // older packet still not received, no delay sample for it
+    }
 }
 
 void
-Tpa::LoadReceivedOnOffPacket (Ptr<const Packet> p_lofp, double timeNow) // lofp - load on-off packet
+Tpa::AddReceivedRecord (uint32_t flow, uint32_t packetID, int64_t timeNow, uint32_t packetSize, uint8_t path)
 {
-  if(p_lofp->GetSize() > 200)
-  {  //filter OnOff packets from the rest (80 IP6-IP6 + 8 UDP + 172 VoIP payload = 260 bytes)
+  m_recordWriter.Add (TpaRecordWriter::RECEIVED, packetID, timeNow, packetSize, flow, path);
+  TpaFlowStats &flowStats = m_flows.GetStats (flow);
+  if (flowStats.received == 0)
+    {
+      flowStats.firstReceived = timeNow;
+    }
+  flowStats.lastReceived = timeNow;
+  flowStats.received = flowStats.received + 1;
+  uint32_t extent;
+  TpaReorderWindow::Result order = m_flows.GetReorderWindow (flow).Add (packetID, extent);
+  m_reorder.Add (order, extent);
+  uint32_t lost = m_flows.GetLossRuns (flow).AddSeq (packetID);
+  if (lost > 0)
+    {
+      m_intervalLost = m_intervalLost + lost;
+      m_intervalLossRuns = m_intervalLossRuns + 1;
+    }
+  if (order == TpaReorderWindow::REORDERED)
+    {
+      flowStats.reordered = flowStats.reordered + 1;
+    }
+  else if (order == TpaReorderWindow::DUPLICATE)
+    {
+      flowStats.duplicates = flowStats.duplicates + 1;
+    }
+  if (m_trafficType == VIDEO_S && m_videoTrace.IsOpen () && order != TpaReorderWindow::DUPLICATE)
+    {
+      m_video.AddReceived (packetID);
+    }
+  flowStats.bytes = flowStats.bytes + packetSize;
+  m_intervalReceived = m_intervalReceived + 1;
+  m_intervalBytes = m_intervalBytes + packetSize;
+  m_throughputBins.Add (TpaNsToMs (timeNow), packetSize);
+  m_handoverTimeline.AddReceived (TpaNsToMs (timeNow));
 
-    Ptr<Packet> packet = p_lofp->Copy ();
-    static receivedPacketParam rpktPar = {};
-    rpktPar.packetSize = packet->GetSize () + 32;  // the Wifi header (802.11 data + LLC) = 32 bytes are removed before the sink
-   
-    Ipv6Header ipv6hdr1;  packet->RemoveHeader(ipv6hdr1);
+  if (TpaIpv6Walker::IsRouteOptimized (path))
+    {
+      m_receivedRo = m_receivedRo + 1;
+    }
+  else if (path & TPA_PATH_TUNNEL)
+    {
+      m_receivedTunnel = m_receivedTunnel + 1;
+    }
+  else
+    {
+      m_receivedDirect = m_receivedDirect + 1;
+    }
 
-/* Waiting for dce 1.3
-    if (ipv6hdr1.GetNextHeader () == 43) // Type 2 Routing IPv6 Extension Header in case of Route Optimization 
-      {
-        //Ipv6ExtensionRoutingHeader ipv6eh;
-        Ipv6ExtensionDestinationHeader ipv6eh; // The Ipv6ExtensionRoutingHeader doesnt work, probably a bug?
-        packet->RemoveHeader (ipv6eh);
-      }
-*/
-    if (ipv6hdr1.GetNextHeader () ==  41) // IPv6 type = 41
-      {
-        Ipv6Header ipv6hdr2;  packet->RemoveHeader(ipv6hdr2);
-      }
+  if (!m_streaming)
+    {
+      receivedDataArray.receivedTime.Push (timeNow);
+      receivedDataArray.key.Push (TpaSeqIndex::MakeKey (flow, packetID));
+      receivedDataArray.packetSize.Push (packetSize);
 
+      int64_t sentTime;
+      if (m_reportInterval.IsStrictlyPositive () && m_flows.GetWindow (flow).Take (packetID, sentTime))
+        {
+          // the per-flow statistics are only computed at the end in this mode
+          int64_t delay = timeNow - sentTime;
+          if (flow >= m_intervalLastDelay.size ())
+            {
+              m_intervalLastDelay.resize (flow + 1, -1);
+            }
+          int64_t &lastDelay = m_intervalLastDelay[flow];
+          int64_t jitter = delay > lastDelay ? delay - lastDelay : lastDelay - delay;
+          AddIntervalDelay (TpaNsToMs (delay), lastDelay < 0 ? -1.0 : TpaNsToMs (jitter));
+          lastDelay = delay;
+        }
+      return;
+    }
 
-    UdpHeader udphdr;     packet->RemoveHeader(udphdr); 
-                          packet->PeekHeader(seqTs);   
+  if (m_streamReceived == 0)
+    {
+      m_startTrafficTime = timeNow;
+    }
+  m_stopTrafficTime = timeNow;
+  m_streamReceived = m_streamReceived + 1;
+  m_streamBytes = m_streamBytes + packetSize;
 
-    rpktPar.receivedTime = timeNow;  
-    rpktPar.packetID = seqTs.GetSeq();
-    receivedDataArray[m_next_receivedPacketIndex] = rpktPar;
-    m_next_receivedPacketIndex = m_next_receivedPacketIndex + 1;
+  int64_t sentTime;
+  if (m_flows.GetWindow (flow).Take (packetID, sentTime))
+    {
+      // the jitter is taken between consecutive packets of the same flow
+      int64_t delay = timeNow - sentTime;
+      int64_t jitter;
+      double jitterMs = -1.0;
+      if (m_flows.AddDelay (flow, delay, jitter))
+        {
+          jitterMs = TpaNsToMs (jitter);
+          m_jitterSum = m_jitterSum + jitter;
+          m_jitters = m_jitters + 1;
+          m_jitterHistogram.Add (jitterMs);
+        }
+      double delayMs = TpaNsToMs (delay);
+      m_delaySum = m_delaySum + delay;
+      m_delays = m_delays + 1;
+      m_delayHistogram.Add (delayMs);
+      m_handoverTimeline.AddDelay (TpaNsToMs (sentTime), TpaNsToMs (timeNow), delayMs, jitterMs);
+      if (m_reportInterval.IsStrictlyPositive ())
+        {
+          AddIntervalDelay (delayMs, jitterMs);
+        }
+    }
+}
 
-  } 
+template <class Parser>
+void
+Tpa::SetParser (void)
+{
+  m_loadSent = &Tpa::LoadSent<Parser>;
+  m_loadReceived = &Tpa::LoadReceived<Parser>;
+  m_sentCallback = MakeCallback (&Tpa::TraceSent<Parser>, this);
+  m_receivedCallback = MakeCallback (&Tpa::TraceReceived<Parser>, this);
 }
 
+void
+Tpa::SetUnknownParser (void)
+{
+  m_loadSent = &Tpa::LoadUnknown;
+  m_loadReceived = &Tpa::LoadUnknown;
+  m_sentCallback = MakeCallback (&Tpa::TraceUnknown, this);
+  m_receivedCallback = m_sentCallback;
+}
 
+template <class Parser>
 void
-Tpa::LoadSentUdpTracePacket (Ptr<const Packet> p_lp, double timeNow)
+Tpa::LoadSent (const Ptr<const Packet> &packet, int64_t timeNow)
 {
+  if (!Parser::Accept (packet))
+    {
+      return;
+    }
+  TpaPacketView view (packet);
+  TpaParsedPacket parsed;
+  if (Parser::ParseSent (view, parsed))
+    {
+      AddSentRecord (m_flows.GetFlow (parsed.key), parsed.seq, timeNow, parsed.size, parsed.path);
+    }
+}
 
-    Ptr<Packet> packet = p_lp->Copy ();   
-    EthernetHeader ethhdr;  packet->RemoveHeader (ethhdr); 
-    Ipv6Header ipv6hdr;     packet->RemoveHeader (ipv6hdr);
-    if (ipv6hdr.GetNextHeader () ==  17) // UDP
-      {    
-        UdpHeader udphdr; packet->RemoveHeader(udphdr);
-        packet->PeekHeader(seqTs);
+template <class Parser>
+void
+Tpa::LoadReceived (const Ptr<const Packet> &packet, int64_t timeNow)
+{
+  if (!Parser::Accept (packet))
+    {
+      return;
+    }
+  TpaPacketView view (packet);
+  TpaParsedPacket parsed;
+  if (Parser::ParseReceived (view, parsed))
+    {
+      AddReceivedRecord (m_flows.GetFlow (parsed.key), parsed.seq, timeNow, parsed.size, parsed.path);
+    }
+}
 
-        static sentPacketParam spktPar = {};
-        spktPar.sentTime = timeNow;  
-        spktPar.packetID = seqTs.GetSeq();
-        sentDataArray[m_next_sentPacketIndex] = spktPar;
-        m_next_sentPacketIndex = m_next_sentPacketIndex + 1;
-      } 
+template <class Parser>
+void
+Tpa::TraceSent (Ptr<const Packet> packet)
+{
+  if (IsLoading ())
+    {
+      LoadSent<Parser> (packet, Simulator::Now ().GetNanoSeconds ());
+    }
 }
 
+template <class Parser>
+void
+Tpa::TraceReceived (Ptr<const Packet> packet)
+{
+  if (IsLoading ())
+    {
+      LoadReceived<Parser> (packet, Simulator::Now ().GetNanoSeconds ());
+    }
+}
 
 void
-Tpa::LoadReceivedUdpTracePacket (Ptr<const Packet> p_lp, double timeNow) 
+Tpa::LoadUnknown (const Ptr<const Packet> &, int64_t)
 {
-    Ptr<Packet> packet = p_lp->Copy ();
-    static receivedPacketParam rpktPar = {};
-    rpktPar.packetSize = packet->GetSize () + 32;  // the Wifi header (802.11 data + LLC) = 32 bytes are removed before the sink
-   
-    Ipv6Header ipv6hdr1;  packet->RemoveHeader(ipv6hdr1);
-    uint8_t m_next_header = ipv6hdr1.GetNextHeader ();
-    if (m_next_header ==  41) // IPv6 in IPv6
-      {
-        Ipv6Header ipv6hdr2;  packet->RemoveHeader(ipv6hdr2);
-        m_next_header = ipv6hdr2.GetNextHeader ();
-      }
-    if (m_next_header ==  17) // UDP
-      {
-        UdpHeader udphdr; packet->RemoveHeader(udphdr); 
-        packet->PeekHeader(seqTs);   
-    
-        rpktPar.receivedTime = timeNow;  
-        rpktPar.packetID = seqTs.GetSeq();
-        receivedDataArray[m_next_receivedPacketIndex] = rpktPar;
-        m_next_receivedPacketIndex = m_next_receivedPacketIndex + 1;
+  // no parser, SetTrafficType warned once
+}
 
-      } 
+void
+Tpa::TraceUnknown (Ptr<const Packet> packet)
+{
+  LoadUnknown (packet, 0);
 }
 
 //************************
@@ -438,13 +1484,19 @@ Tpa::LoadReceivedUdpTracePacket (Ptr<const Packet> p_lp, double timeNow)
 double 
 Tpa::CalculateThroughput ()
 {
-  uint32_t temp_received_troughput = 0;
-  for (int i=0; i < m_receivedPacketsNumber; i++)
+  uint64_t temp_received_troughput = m_streamBytes;
+  if (!m_streaming)
     {
-      temp_received_troughput = temp_received_troughput + receivedDataArray[i].packetSize; // in bytes
+      temp_received_troughput = 0;
+      const TpaRecordStore<uint32_t> &sizes = receivedDataArray.packetSize;
+      for (std::size_t c = 0; c < sizes.GetNChunks (); c++)
+        {
+          temp_received_troughput = temp_received_troughput + TpaKernels::SumU32 (sizes.GetChunk (c), sizes.GetChunkLength (c)); // in bytes
+        }
     }
+  m_receivedBytes = temp_received_troughput;
 
-  return (temp_received_troughput * 8 / 1024) / ((m_stopTrafficTime - m_startTrafficTime) / 1000); // [Kbps]
+  return (temp_received_troughput * 8 / 1024) / (GetTrafficDuration () / 1000); // [Kbps]
 
   // return  m_receivedPacketsNumber * (m_receivedPacketSize * 8 / 1024 ) / ((m_stopTrafficTime - m_startTrafficTime) / 1000);
   // bytes*8bits/1024=[Kbps] (1000=k; 1024=K)
@@ -461,80 +1513,166 @@ double
 Tpa::CalculateEndToEndDelayAvg ()
 {
   // End-to-End delay [ms] calculation -- Everything here is in Milli seconds [ms]
-  double m_idelay = 0.0;
-  for (int i = 0; i < m_sentPacketsNumber; i++)
+  // The sent packets are indexed by (flow, sequence number), so every received
+  // packet is matched with a single lookup; a sequence number is matched only
+  // once, duplicated receptions don't add delays.  The delays are taken by
+  // column: the sent time of every received packet is gathered into
+  // delaysTempArray (its received time if it has none), then subtracted from
+  // the received times.  The jitter samples are taken here too, between
+  // consecutive packets of the same flow.
+  m_delays = 0;
+  m_jitters = 0;
+  delaysTempArray.Reset ();
+  jitterTempArray.Reset ();
+  delaysTempArray.Resize (m_receivedPacketsNumber);
+  jitterTempArray.Resize (m_receivedPacketsNumber);
+  if (m_sentPacketsNumber > 0)
     {
-      for (int j=0; j < m_receivedPacketsNumber; j++)
+      const TpaRecordStore<uint64_t> &sentKeys = sentDataArray.key;
+      const TpaRecordStore<int64_t> &sentTimes = sentDataArray.sentTime;
+      const TpaRecordStore<uint64_t> &receivedKeys = receivedDataArray.key;
+      const TpaRecordStore<int64_t> &receivedTimes = receivedDataArray.receivedTime;
+
+      // the keys are below 2^48, signed compares order them
+      int64_t minKey = sentKeys[0];
+      int64_t maxKey = minKey;
+      for (std::size_t c = 0; c < sentKeys.GetNChunks (); c++)
+        {
+          TpaKernels::MinMax (reinterpret_cast<const int64_t *> (sentKeys.GetChunk (c)), sentKeys.GetChunkLength (c),
+                              minKey, maxKey);
+        }
+      TpaSeqIndex sentIndex;
+      sentIndex.Prepare (minKey, maxKey, m_sentPacketsNumber);
+      for (int i = 0; i < m_sentPacketsNumber; i++)
+        {
+          sentIndex.Insert (sentKeys[i], i);
+        }
+
+      std::vector<bool> matched (m_receivedPacketsNumber, false);
+      for (int j = 0; j < m_receivedPacketsNumber; j++)
+        {
+          uint32_t i = sentIndex.Take (receivedKeys[j]);
+          matched[j] = i != TpaSeqIndex::NOT_FOUND;
+          delaysTempArray[j] = matched[j] ? sentTimes[i] : receivedTimes[j];
+        }
+      for (std::size_t c = 0; c < delaysTempArray.GetNChunks (); c++)
+        {
+          TpaKernels::Subtract (receivedTimes.GetChunk (c), delaysTempArray.GetChunk (c), delaysTempArray.GetChunk (c),
+                                delaysTempArray.GetChunkLength (c));
+        }
+
+      // the jitter by column too: the previous delay of the flow of every
+      // matched packet is gathered into jitterTempArray (its own delay if it
+      // has none, giving 0), then AbsDiff takes |delay - previous|
+      std::vector<bool> haveJitter (m_receivedPacketsNumber, false);
+      std::vector<int64_t> lastDelay (m_flows.GetNFlows ());
+      std::vector<bool> haveLast (m_flows.GetNFlows ());
+      for (uint32_t flow = 0; flow < m_flows.GetNFlows (); flow++)
         {
-          if (receivedDataArray[j].packetID == sentDataArray[i].packetID)
-            { 
-              m_idelay = receivedDataArray[j].receivedTime - sentDataArray[i].sentTime;
-              delaysTempArray[m_next_delayIndex] = m_idelay;
-              m_next_delayIndex = m_next_delayIndex + 1;
-              break;
+          lastDelay[flow] = m_flows.GetStats (flow).lastDelay;
+          haveLast[flow] = m_flows.GetStats (flow).delay.GetCount () > 0;
+        }
+      for (int j = 0; j < m_receivedPacketsNumber; j++)
+        {
+          uint32_t flow = uint32_t (receivedKeys[j] >> 32);
+          haveJitter[j] = matched[j] && haveLast[flow];
+          jitterTempArray[j] = haveJitter[j] ? lastDelay[flow] : delaysTempArray[j];
+          if (matched[j])
+            {
+              lastDelay[flow] = delaysTempArray[j];
+              haveLast[flow] = true;
             }
-        }    
+        }
+      for (std::size_t c = 0; c < jitterTempArray.GetNChunks (); c++)
+        {
+          TpaKernels::AbsDiff (delaysTempArray.GetChunk (c), jitterTempArray.GetChunk (c), jitterTempArray.GetChunk (c),
+                               jitterTempArray.GetChunkLength (c));
+        }
 
+      for (int j = 0; j < m_receivedPacketsNumber; j++)
+        {
+          if (!matched[j])
+            {
+              continue;
+            }
+          int64_t m_idelay = delaysTempArray[j]; // [ns]
+          int64_t m_iJitter = jitterTempArray[j];
+          m_delays = m_delays + 1;
+          m_delayHistogram.Add (TpaNsToMs (m_idelay));
+          m_flows.AddSample (uint32_t (receivedKeys[j] >> 32), m_idelay, m_iJitter, haveJitter[j]);
+          if (haveJitter[j])
+            {
+              m_jitters = m_jitters + 1;
+              m_jitterHistogram.Add (TpaNsToMs (m_iJitter));
+            }
+          m_handoverTimeline.AddDelay (TpaNsToMs (receivedTimes[j] - m_idelay), TpaNsToMs (receivedTimes[j]),
+                                       TpaNsToMs (m_idelay), haveJitter[j] ? TpaNsToMs (m_iJitter) : -1.0);
+        }
     }
-  int m_elementsNumber_delaysTempArray = m_next_delayIndex;
-  if (m_receivedPacketsNumber != m_elementsNumber_delaysTempArray) 
+  if (m_receivedPacketsNumber != int (m_delays))
     {
-      std::cout << "m_receivedPacketsNumber"  << m_receivedPacketsNumber << std::endl;
-    } 
-  double m_delaySum = 0;
-  for (int k=0; k < m_elementsNumber_delaysTempArray; k++)
+      NS_LOG_WARN ("Tpa: " << m_receivedPacketsNumber - int (m_delays) << " of " << m_receivedPacketsNumber
+                   << " received packets not matched with a sent one (duplicates, or sent before the Tpa was loaded)");
+    }
+  if (m_delays == 0)
     {
-      m_delaySum = m_delaySum + delaysTempArray[k];
+      return 0.0;
+    }
+  int64_t m_delaySum = 0; // [ns], exact
+  for (std::size_t c = 0; c < delaysTempArray.GetNChunks (); c++)
+    {
+      m_delaySum = m_delaySum + TpaKernels::SumI64 (delaysTempArray.GetChunk (c), delaysTempArray.GetChunkLength (c));
     }
 
-  return m_delaySum / m_elementsNumber_delaysTempArray;
+  return TpaNsToMs (m_delaySum) / m_delays;
 }
 
 double 
 Tpa::CalculateJitterAvg ()
 {
-  double m_iJitter = 0.0;
-  int m_elementsNumber_delaysTempArray = m_next_delayIndex;
-  // the jitter between second and first packet delay is not included 
-  for (int i = 0; i < m_elementsNumber_delaysTempArray - 2; i++) 
+  // the jitter samples are collected per flow by CalculateEndToEndDelayAvg
+  if (m_jitters == 0)
     {
-      m_iJitter = abs(delaysTempArray[i + 1] - delaysTempArray[i]);
-      jitterTempArray[m_next_jitterIndex] = m_iJitter;
-      m_next_jitterIndex = m_next_jitterIndex + 1;
+      return 0.0;
     }
-
-  int m_elementsNumber_jitterTempArray = m_next_jitterIndex;
-  if (m_elementsNumber_jitterTempArray != m_elementsNumber_delaysTempArray - 2)
-    {
-      std::cout << "Error - mismatch calculating! Tpa::CalculateJitterAvg" << std::endl;
-    } 
-  double m_jitterSum = 0;
-  for (int j=0; j < m_elementsNumber_jitterTempArray; j++)
+  int64_t m_jitterSum = 0; // [ns], exact
+  for (std::size_t c = 0; c < jitterTempArray.GetNChunks (); c++)
     {
-      m_jitterSum = m_jitterSum + jitterTempArray[j];
+      m_jitterSum = m_jitterSum + TpaKernels::SumI64 (jitterTempArray.GetChunk (c), jitterTempArray.GetChunkLength (c));
     }
 
-  return m_jitterSum / m_elementsNumber_jitterTempArray;
+  return TpaNsToMs (m_jitterSum) / m_jitters;
 }
 
 double 
-Tpa::CalculateR_Value () // Simple analysis of the impact of packet loss and delay on voice transmission quality
+Tpa::CalculateR_Value () // E-model (G.107) rating of the impact of packet loss and delay on voice transmission quality
 {
-  if (m_endToEndDelayAvg / 2 < 165)
-    {
-      return 92.68 - 22 * log(1 + 0.22 * m_packetLossPercentage);
-    }
-  else 
-    {
-      return 92.68 - (0.1 * m_endToEndDelayAvg / 2 - 15.9) - 22 * log(1 + 0.22 * m_packetLossPercentage);
-      std::cout << "Some error, should not enter this code" << std::endl;
-    }
+  return m_eModel.GetR (OneWayDelay (m_endToEndDelayAvg), m_packetLossPercentage, GetLossRuns ().GetBurstRatio ());
+}
+
+double
+Tpa::OneWayDelay (double delay) const
+{
+  // the ping delay is the round trip time
+  return m_trafficType == PING ? delay / 2 : delay;
 }
 
 double 
 Tpa::CalculateHandoverTime ()
 {
-  return (m_L3Thf - m_L3Ths)/1000; // /1000 => in seconds
+  // from the association to the Binding Acknowledgement, as before
+  const TpaHandover *handover = m_handovers.GetLastComplete ();
+  if (handover == 0)
+    {
+      return 0.0;
+    }
+  return handover->GetL3Delay () / 1000; // /1000 => in seconds
+}
+
+double
+Tpa::GetTrafficDuration (void) const
+{
+  return TpaNsToMs (m_stopTrafficTime - m_startTrafficTime);
 }
 
 
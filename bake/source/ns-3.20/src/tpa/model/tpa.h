@@ -21,7 +21,29 @@
 
 #include "ns3/object.h"
 #include "ns3/packet.h"
+#include "ns3/nstime.h"
+#include "ns3/event-id.h"
+#include "ns3/callback.h"
+#include "ns3/output-stream-wrapper.h"
+#include "ns3/mac48-address.h"
 #include <ns3/applications-module.h>
+#include "tpa-record-store.h"
+#include "tpa-running-stats.h"
+#include "tpa-seq-window.h"
+#include "tpa-histogram.h"
+#include "tpa-packet-view.h"
+#include "tpa-ipv6-walker.h"
+#include "tpa-flow-table.h"
+#include "tpa-time.h"
+#include "tpa-throughput-bins.h"
+#include "tpa-record-writer.h"
+#include "tpa-handover-detector.h"
+#include "tpa-handover-timeline.h"
+#include "tpa-e-model.h"
+#include "tpa-video-trace.h"
+#include "tpa-traffic-parser.h"
+#include "tpa-collector.h"
+#include "tpa-output-file.h"
 
 namespace ns3 {
 /**
@@ -33,61 +55,235 @@ namespace ns3 {
  * The idea is to load the sent and received packets in the sinks of the ruuning simulation script
  * in the end communication nodes and to calculate the traffic performances.
  * 
- * Note:
- * The analyzing is limited by the size of the arrays that hold packet information,
- * correspondigly the application packet rate.
- * (Enough for me to simulate 2.5Mbps application UDP traffic with 512byte packets for 150 sec)
- * This static allocation takes about 5 to 10 MB RAM per MN node while simulating (fair enought :-),
- * It coul'd be modified to approximately calculate the number of packets needed and allocate enough space to optimize memory allocation.
- * Dinamic memory allocation arrises a lot of problems for me ;)
+ * The results (throughput, loss, delay and jitter with their quantiles,
+ * reordering, loss runs, E-model R and MOS, handovers, per flow and per
+ * path) are written by PrintTrafficPerformances to the files of the
+ * attribute OutputDirectory; the other attributes turn on the optional
+ * analyses.
  *   
  */
 class Tpa : public Object
 {
 
 public:
+  /// version of the JSON document of WriteResults, incremented when a field changes meaning or goes
+  static const uint32_t RESULTS_SCHEMA_VERSION = 1;
+
   static TypeId GetTypeId (void);
   Tpa ();
   virtual ~Tpa ();
+  /**
+   * \param stype PING, UDPCBR, TCPCBR, VOIP or VIDEO_S; picks the parser of the
+   *        traffic type (TpaTrafficParser) once, the loaders don't switch on it per packet
+   */
   void SetTrafficType (std::string stype);
+  void SetStreamingMode (bool enable);
+  bool IsStreamingMode (void) const;
+  void SetInFlightWindow (uint32_t size);
+  uint32_t GetInFlightWindow (void) const;
+  void SetReorderWindow (uint32_t size);
+  uint32_t GetReorderWindow (void) const;
+  const TpaReorderStats & GetReorderStats (void) const;
+  void SetLossGmin (uint32_t gmin);
+  uint32_t GetLossGmin (void) const;
+  /// \return the loss runs of all the flows merged
+  TpaLossRuns GetLossRuns (void) const;
+  /**
+   * \param codec E-model codec profile: G.711, G.729 or G.722
+   */
+  void SetCodec (std::string codec);
+  std::string GetCodec (void) const;
+  /**
+   * \param fileName video trace of the UdpTraceClient, for VIDEO_S; empty disables
+   *        the frame analysis.  Set it before the traffic starts.
+   */
+  void SetVideoTrace (std::string fileName);
+  std::string GetVideoTrace (void) const;
+  /// \param size MaxPacketSize of the UdpTraceClient; used by the next SetVideoTrace
+  void SetVideoPacketSize (uint32_t size);
+  uint32_t GetVideoPacketSize (void) const;
+  /// \return the frame loss and decodability of the video frames so far
+  TpaVideoQuality GetVideoQuality (void) const;
+  /// \param timeNow [ms], rounded to the nanosecond
   void LoadSentPacket (Ptr<const Packet> p_loadedPacket, double timeNow);
   void LoadReceivedPacket (Ptr<const Packet> p_loadedPacket, double timeNow);
+  /// \param timeNow exact, e.g. Simulator::Now ()
+  void LoadSentPacket (Ptr<const Packet> p_loadedPacket, Time timeNow);
+  void LoadReceivedPacket (Ptr<const Packet> p_loadedPacket, Time timeNow);
+  /**
+   * \return a trace sink loading the sent packets at Simulator::Now, bound
+   *         to the parser of the traffic type; call SetTrafficType first
+   */
+  Callback<void, Ptr<const Packet> > GetSentCallback (void) const;
+  /// \return as GetSentCallback, for the received packets
+  Callback<void, Ptr<const Packet> > GetReceivedCallback (void) const;
+  /**
+   * \param time the packets of GetSentCallback and GetReceivedCallback are ignored
+   *        from this time on (e.g. when the applications stop), 0 for never
+   */
+  void SetLoadUntil (Time time);
+  Time GetLoadUntil (void) const;
+  /**
+   * Load a frame received by the MN (PHY trace, from the 802.11 header): the
+   * handovers are found by TpaHandoverDetector, their impact on the traffic
+   * is appended to the result line (TpaHandoverTimeline)
+   */
   void LoadControlPacket (Ptr<const Packet> p_loadedPacket, double timeNow);
+  void LoadControlPacket (Ptr<const Packet> p_loadedPacket, Time timeNow);
+  /**
+   * Load a frame sent by the MN (PHY trace, from the 802.11 header), for the handover
+   * phases started by the MN: association request, RS, DAD and BU
+   */
+  void LoadSentControlPacket (Ptr<const Packet> p_loadedPacket, double timeNow);
+  void LoadSentControlPacket (Ptr<const Packet> p_loadedPacket, Time timeNow);
+  /// \return a trace sink of LoadControlPacket at Simulator::Now (PhyRxEnd of the MN)
+  Callback<void, Ptr<const Packet> > GetControlCallback (void);
+  /// \return a trace sink of LoadSentControlPacket at Simulator::Now (PhyTxBegin of the MN)
+  Callback<void, Ptr<const Packet> > GetSentControlCallback (void);
+  /**
+   * \param address MAC of the MN, the frames received for other stations are ignored;
+   *        learnt from the first LoadSentControlPacket when not set
+   */
+  void SetMobileNodeAddress (Mac48Address address);
+  const TpaHandoverDetector & GetHandoverDetector (void) const;
+  /**
+   * \param window length of the windows before and after every handover
+   *        in which the delay and jitter are averaged
+   */
+  void SetHandoverWindow (Time window);
+  Time GetHandoverWindow (void) const;
+  /**
+   * \param duration longest handover, from its start; one not finished by
+   *        then (BA lost) is taken to end there
+   */
+  void SetHandoverMaxDuration (Time duration);
+  Time GetHandoverMaxDuration (void) const;
+  /// \return the number of handovers started, finished or not
+  uint32_t GetNHandovers (void) const;
+  /// \return the impact of handover i on the traffic; the delays are only known after PrintTrafficPerformances in buffered mode
+  TpaHandoverImpact GetHandoverImpact (uint32_t i) const;
+  /**
+   * Write the result line (tempresults.txt), one line per flow (tempflows.txt),
+   * the video frames (tempvideo.txt) and the JSON document (results.json,
+   * WriteResults); every file is replaced atomically (TpaOutputFile)
+   */
   void PrintTrafficPerformances ();
+  /// write the throughput series of every ThroughputBins width (Throughput.txt)
   void PrintThroughput ();
+  /**
+   * \return the results of the packets loaded so far, e.g. for a TpaCollector;
+   *         like PrintTrafficPerformances, to be called once the traffic is over
+   */
+  TpaNodeSummary GetSummary (void);
+  const TpaHistogram & GetDelayHistogram (void) const;
+  const TpaHistogram & GetJitterHistogram (void) const;
+  const TpaFlowTable & GetFlowTable (void) const;
+  /**
+   * \param interval time between two periodic reports, 0 stops the reports;
+   *        the first report is scheduled one interval from now
+   */
+  void SetReportInterval (Time interval);
+  Time GetReportInterval (void) const;
+  /**
+   * \param stream where the periodic reports are appended; when not set,
+   *        tempseries.txt is opened in append mode at the first report
+   */
+  void SetReportStream (Ptr<OutputStreamWrapper> stream);
+  /// \param directory where the result files are written, empty for the working directory
+  void SetOutputDirectory (std::string directory);
+  std::string GetOutputDirectory (void) const;
+  /// \param runId appended to the names of the result files, empty for none
+  void SetRunId (std::string runId);
+  std::string GetRunId (void) const;
+  /// \return the path of a result file, e.g. GetOutputFileName ("tempresults", ".txt")
+  std::string GetOutputFileName (std::string name, std::string extension) const;
+  /**
+   * Write the results as one JSON object: schema version, run id, totals,
+   * percentiles, paths, reordering, loss model, handovers, flows and video
+   * frames; like PrintTrafficPerformances, to be called once the traffic is over
+   */
+  void WriteResults (std::ostream &os);
+  /**
+   * \param widths comma separated bin widths [ms] of the PrintThroughput series, e.g. "10,100,1000";
+   *        set it before the traffic starts
+   */
+  void SetThroughputBins (std::string widths);
+  std::string GetThroughputBins (void) const;
+  /**
+   * \param fileName binary per-packet record file (TpaRecordWriter) created now,
+   *        empty to stop writing; the file is completed by PrintTrafficPerformances
+   */
+  void SetRecordFile (std::string fileName);
+  std::string GetRecordFile (void) const;
+  /**
+   * \param capacity records queued to the background writer thread of the
+   *        record file, 0 writes from the simulator thread; used by the next SetRecordFile
+   */
+  void SetRecordQueue (uint32_t capacity);
+  uint32_t GetRecordQueue (void) const;
+  /**
+   * \param drop drop (and count) the records when the queue is full instead of
+   *        waiting for the writer thread; used by the next SetRecordFile
+   */
+  void SetRecordDropWhenFull (bool drop);
+  bool GetRecordDropWhenFull (void) const;
   bool m_enable_column_labels;
 
 
+protected:
+  virtual void DoDispose (void);
+
 private:
-  void LoadSentEchoRequestPacket (Ptr<const Packet> p_lerp, double timeNow);
-  void LoadReceivedEchoReplyPacket (Ptr<const Packet> p_lerp, double timeNow);
-  void LoadSentOnOffPacket (Ptr<const Packet> p_loadedPacket, double timeNow);
-  void LoadReceivedOnOffPacket (Ptr<const Packet> p_loadedPacket, double timeNow);
-  void LoadSentUdpTracePacket (Ptr<const Packet> p_loadedPacket, double timeNow);
-  void LoadReceivedUdpTracePacket (Ptr<const Packet> p_loadedPacket, double timeNow);
+  void Report (void);
+  bool OpenOutput (TpaOutputFile &file, std::string name, std::string extension) const;
+  void CommitOutput (TpaOutputFile &file) const;
+  void AddIntervalDelay (double delay, double jitter);
+  void LoadHandoverFrame (Ptr<const Packet> p_frame, int64_t timeNow, bool sent);
+  void ResetInterval (void);
+  // loaders of the traffic type, chosen by SetTrafficType (SetParser)
+  // timeNow [ns] from here on
+  typedef void (Tpa::*Loader) (const Ptr<const Packet> &packet, int64_t timeNow);
+  template <class Parser> void SetParser (void);
+  void SetUnknownParser (void); // no parser for the traffic type, the packets are ignored
+  template <class Parser> void LoadSent (const Ptr<const Packet> &packet, int64_t timeNow);
+  template <class Parser> void LoadReceived (const Ptr<const Packet> &packet, int64_t timeNow);
+  template <class Parser> void TraceSent (Ptr<const Packet> packet);
+  template <class Parser> void TraceReceived (Ptr<const Packet> packet);
+  void LoadUnknown (const Ptr<const Packet> &packet, int64_t timeNow);
+  void TraceUnknown (Ptr<const Packet> packet);
+  void TraceControl (Ptr<const Packet> packet);
+  void TraceSentControl (Ptr<const Packet> packet);
+  bool IsLoading (void) const;
+  void AddSentRecord (uint32_t flow, uint32_t packetID, int64_t timeNow, uint32_t packetSize, uint8_t path);
+  void AddReceivedRecord (uint32_t flow, uint32_t packetID, int64_t timeNow, uint32_t packetSize, uint8_t path);
+  bool CalculateTrafficPerformances (void);
   double CalculateThroughput ();
   double CalculatePacketLossPrecentage ();
   double CalculateEndToEndDelayAvg ();
   double CalculateJitterAvg ();
   double CalculateR_Value ();
+  double OneWayDelay (double delay) const;
   double CalculateHandoverTime ();
+  double GetTrafficDuration (void) const; // first to last received packet [ms]
 
-  struct sentPacketParam
+  // the buffered records, one column per field, so the TpaKernels run over
+  // arrays of one type; the columns of a record have the same chunks
+  struct sentPacketColumns
   {
-    double   sentTime;
-    uint32_t packetID;
+    TpaRecordStore<int64_t>  sentTime;     // [ns]
+    TpaRecordStore<uint64_t> key;          // TpaSeqIndex::MakeKey (flow, packetID)
   };
-  struct receivedPacketParam
+  struct receivedPacketColumns
   {
-    double   receivedTime;
-    uint32_t packetID;
-    uint32_t packetSize; // in bytes
+    TpaRecordStore<int64_t>  receivedTime; // [ns]
+    TpaRecordStore<uint64_t> key;
+    TpaRecordStore<uint32_t> packetSize;   // in bytes
   };
 
-  sentPacketParam     sentDataArray[100000];
-  receivedPacketParam receivedDataArray[100000];
-  double delaysTempArray[100000];
-  double jitterTempArray[100000];
+  sentPacketColumns       sentDataArray;
+  receivedPacketColumns   receivedDataArray;
+  TpaRecordStore<int64_t> delaysTempArray;  // [ns], per received packet, 0 for a duplicate
+  TpaRecordStore<int64_t> jitterTempArray;  // [ns], per received packet, 0 without a sample
 
 
   enum TrafficType_e{
@@ -99,25 +295,80 @@ private:
   };
   
   uint8_t  m_trafficType;
+  Loader   m_loadSent;
+  Loader   m_loadReceived;
+  Callback<void, Ptr<const Packet> > m_sentCallback;
+  Callback<void, Ptr<const Packet> > m_receivedCallback;
+  Time     m_loadUntil;
   int      m_sentPacketsNumber;
   int      m_receivedPacketsNumber;
-  int      m_next_sentPacketIndex;
-  int      m_next_receivedPacketIndex;
-  int      m_next_delayIndex;
-  int      m_next_jitterIndex;
   int      m_receivedPacketSize;
   int      m_sentPacketSize;
-  double   m_startTrafficTime;
-  double   m_stopTrafficTime;
+  uint64_t m_receivedBytes;
+  bool     m_calculated;     // the results are calculated only once
+  int64_t  m_startTrafficTime; // first received packet [ns]
+  int64_t  m_stopTrafficTime;  // last received packet [ns]
   double   m_throughput;
   double   m_packetLossPercentage;
   double   m_endToEndDelayAvg;
   double   m_rValue;
+  double   m_mos;
+  TpaEModel m_eModel;
   double   m_Jitter;
-  double   m_L3Ths; // L3 handover start time
-  double   m_L3Thf; // L3 handover finish time
-  double   m_L3Th;
-  SeqTsHeader seqTs;
+  double   m_L3Th;  // L3 handover time of the last complete handover [s]
+  TpaHandoverDetector m_handovers;
+  TpaHandoverTimeline m_handoverTimeline;
+  TpaHistogram m_delayHistogram;  // one-way delay [ms], percentiles in the result line
+  TpaHistogram m_jitterHistogram; // inter-packet delay variation [ms]
+
+  TpaFlowTable m_flows;
+  TpaReorderStats m_reorder;
+
+  // VIDEO_S frames
+  std::string         m_videoTraceFile;
+  uint32_t            m_videoPacketSize;
+  TpaVideoTrace       m_videoTrace;
+  TpaVideoReassembler m_video;
+
+  // streaming mode
+  bool            m_streaming;
+  int64_t         m_delaySum;      // [ns], exact
+  int64_t         m_jitterSum;     // [ns]
+  uint32_t        m_delays;        // samples, in both modes
+  uint32_t        m_jitters;
+  uint32_t        m_streamSent;
+  uint32_t        m_streamReceived;
+  uint32_t        m_streamEvicted; // sent packets dropped from the window before being received
+  uint64_t        m_streamBytes;
+
+  // periodic report, statistics of the current interval
+  Time            m_reportInterval;
+  EventId         m_reportEvent;
+  Ptr<OutputStreamWrapper> m_reportStream;
+  std::string     m_outputDirectory;
+  std::string     m_runId;
+  bool            m_reportHeader;           // column labels already written
+  uint32_t        m_intervalSent;
+  uint32_t        m_intervalReceived;
+  uint64_t        m_intervalBytes;
+  TpaRunningStats m_intervalDelay;
+  TpaRunningStats m_intervalJitter;
+  TpaHistogram    m_intervalDelayHistogram;
+  uint32_t        m_intervalLost;           // found from the sequence numbers
+  uint32_t        m_intervalLossRuns;
+  std::vector<int64_t> m_intervalLastDelay; // per flow [ns], buffered mode only; < 0 before the first delay
+
+  TpaThroughputBins m_throughputBins;
+  std::string       m_throughputBinWidths;
+  TpaRecordWriter   m_recordWriter;
+  std::string       m_recordFile;
+  uint32_t          m_recordQueue;
+  bool              m_recordDropWhenFull;
+
+  // received packets by path (TpaIpv6Walker)
+  uint32_t m_receivedDirect;
+  uint32_t m_receivedTunnel;
+  uint32_t m_receivedRo;
 };
 
 } // namespace ns3
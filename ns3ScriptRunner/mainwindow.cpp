@@ -521,6 +521,9 @@ void MainWindow::composeCommandLine()
     temp_arg_com = " --anim_enable=";     arg_com.append(temp_arg_com); temp_arg_com.clear();
     temp_arg_com = anim_enable;           arg_com.append(temp_arg_com); temp_arg_com.clear();
 
+    // tempresults.txt is read from there (run)
+    temp_arg_com = " --output_dir=/root/workspace/bake/source/ns-3-dce"; arg_com.append(temp_arg_com); temp_arg_com.clear();
+
 
     argument << "--run" << arg_com;
 